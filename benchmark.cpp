@@ -0,0 +1,595 @@
+/*****************************************************************
+ * @author Suraj Ajjampur
+ * @file   benchmark.cpp
+ *
+ * @brief This C++ source file implements the long-running benchmarks
+ *        selected with --benchmark on the command line.
+ *
+ * @date 16 Oct 2026
+********************************************************************/
+
+#include "benchmark.h"
+#include "trieber_stack.h"
+#include "msq.h"
+#include "elimination.h"
+#include "ring_queue.h"
+#include "spsc_mpsc_queue.h"
+#include "flat_combining.h"
+#include "sgl.h"
+#include "two_lock_queue.h"
+#include "faa_queue.h"
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <sys/resource.h>
+
+using namespace std;
+
+/** Returns the peak resident set size of the process in kilobytes */
+long peak_rss_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // Reported in KB on Linux
+}
+
+/** Runs producers and consumers concurrently on one container. The
+ *  producers insert their share of values `rounds` times, the consumers
+ *  remove until every inserted value has been taken out. With no producers
+ *  a single thread alternates inserts and removes.
+ *  Producers back off while more than values.size() items are outstanding,
+ *  so the container itself stays small and the footprint measured is the
+ *  one of the removed nodes.
+ *
+ *  If stall_ms is positive an extra thread calls stall(stall_ms, done) while
+ *  the others run, which models a reader preempted inside an operation.
+ *
+ * @param insert Callable inserting one int into the container
+ * @param remove Callable removing one int, returning an empty optional when
+ *               the container is empty
+ * @param stall  Callable that enters an operation and sleeps for the given
+ *               ms or until done is set
+ * @return The number of operations performed (inserts + removes)
+ */
+template <typename Insert, typename Remove, typename Stall>
+static long producer_consumer(std::vector<int>& values, int producers, int consumers, int rounds,
+                              Insert insert, Remove remove, Stall stall, int stall_ms) {
+    long total = (long)values.size() * rounds;
+    long window = (long)values.size();
+    atomic<long> inserted(0);
+    atomic<long> removed(0);
+    atomic<bool> done(false);
+
+    std::thread staller;
+    if (stall_ms > 0) {
+        staller = std::thread([&]() { stall(stall_ms, done); });
+    }
+
+    if (producers == 0) {
+        for (int r = 0; r < rounds; ++r) {
+            for (int v : values) {
+                insert(v);
+                if (remove()) removed.fetch_add(1, RELAXED);
+            }
+        }
+    } else {
+        std::vector<std::thread> threads;
+
+        for (int i = 0; i < producers; ++i) {
+            threads.push_back(std::thread([&, i]() {
+                for (int r = 0; r < rounds; ++r) {
+                    for (size_t j = i; j < values.size(); j += producers) {
+                        while (inserted.load(RELAXED) - removed.load(RELAXED) >= window) {
+                            std::this_thread::yield(); // Let consumers catch up
+                        }
+                        insert(values[j]);
+                        inserted.fetch_add(1, RELAXED);
+                    }
+                }
+            }));
+        }
+        for (int i = 0; i < consumers; ++i) {
+            threads.push_back(std::thread([&]() {
+                while (removed.load(RELAXED) < total) {
+                    if (remove()) {
+                        removed.fetch_add(1, RELAXED);
+                    } else {
+                        std::this_thread::yield(); // Let producers catch up
+                    }
+                }
+            }));
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    done.store(true, RELEASE);
+    if (staller.joinable()) {
+        staller.join();
+    }
+
+    if (removed.load(RELAXED) != total) {
+        cerr << "Error: Removed " << removed.load() << " values, expected " << total << endl;
+    }
+    return 2 * total;
+}
+
+/** Holds a guard on `head` for ms milliseconds, as a preempted reader
+ *  would, or until the benchmark is done
+ */
+template <typename Reclaimer, typename N>
+static void stall_in_operation(const atomic<N*>& head, int ms, const atomic<bool>& done) {
+    typename Reclaimer::Guard guard;
+    guard.protect(0, head);
+    for (int i = 0; i < ms && !done.load(ACQUIRE); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/** Same as above for a tagged {pointer, counter} head */
+template <typename Reclaimer, typename N>
+static void stall_in_operation(const atomic_tagged<N>& head, int ms, const atomic<bool>& done) {
+    typename Reclaimer::Guard guard;
+    guard.set(0, head.load().ptr);
+    for (int i = 0; i < ms && !done.load(ACQUIRE); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+template <typename Reclaimer>
+static long run_reclamation(std::vector<int>& values, const std::string& data_structure,
+                            const std::string& optimization, int numThreads, int rounds, int stall_ms) {
+    if (data_structure == "TS" && optimization == "Elimination") {
+        tstack_e<int, Reclaimer> stack(elimination_array_size(numThreads));
+        return producer_consumer(values, numThreads / 2, numThreads - numThreads / 2, rounds,
+                                 [&](int v) { stack.push(v); },
+                                 [&]() { return stack.pop(); },
+                                 [&](int ms, const atomic<bool>& done) { stall_in_operation<Reclaimer>(stack.top, ms, done); }, stall_ms);
+    } else if (data_structure == "TS") {
+        tstack<int, Reclaimer> stack;
+        return producer_consumer(values, numThreads / 2, numThreads - numThreads / 2, rounds,
+                                 [&](int v) { stack.push(v); },
+                                 [&]() { return stack.pop(); },
+                                 [&](int ms, const atomic<bool>& done) { stall_in_operation<Reclaimer>(stack.top, ms, done); }, stall_ms);
+    } else if (data_structure == "msqueue" && !Reclaimer::recycles) {
+        msqueue<int, std::conditional_t<Reclaimer::recycles, NoReclamation, Reclaimer>> queue;
+        return producer_consumer(values, numThreads / 2, numThreads - numThreads / 2, rounds,
+                                 [&](int v) { queue.enqueue(v); },
+                                 [&]() { return queue.dequeue(); },
+                                 [&](int ms, const atomic<bool>& done) { stall_in_operation<Reclaimer>(queue.head, ms, done); }, stall_ms);
+    }
+    cerr << "Error: The reclamation benchmark supports TS and msqueue only, recycle supports TS only." << endl;
+    return 0;
+}
+
+/**
+ * @brief Measures throughput and memory footprint of a lock-free container
+ *        under a given reclamation scheme.
+ *
+ * Producers and consumers run concurrently for `rounds` passes over the
+ * input. Without reclamation every removed node is leaked and the peak RSS
+ * grows linearly with the number of rounds; with reclamation it stays
+ * bounded by the container size plus the retire lists.
+ *
+ * With stall_ms set, one extra thread sits inside an operation for that
+ * long. Hazard pointers still free everything but the node it protects,
+ * while epochs cannot advance and the footprint grows for the whole stall.
+ *
+ * @param values         Input values inserted on every round
+ * @param data_structure "TS" (with optimization "Elimination" for tstack_e) or "msqueue"
+ * @param reclamation    "none" (leaking baseline), "hazard", "epoch" or "recycle" (TS only)
+ * @param numThreads     Total number of producer and consumer threads
+ * @param rounds         Number of passes each producer makes over its values
+ * @param stall_ms       Time a reader stays stalled inside an operation, 0 for none
+ */
+void reclamation_benchmark(std::vector<int>& values, const std::string& data_structure,
+                           const std::string& optimization, const std::string& reclamation,
+                           int numThreads, int rounds, int stall_ms) {
+    long rss_before = peak_rss_kb();
+    auto start_time = chrono::high_resolution_clock::now();
+
+    long ops;
+    if (reclamation == NoReclamation::name) {
+        ops = run_reclamation<NoReclamation>(values, data_structure, optimization, numThreads, rounds, stall_ms);
+    } else if (reclamation == HazardPointers::name) {
+        ops = run_reclamation<HazardPointers>(values, data_structure, optimization, numThreads, rounds, stall_ms);
+    } else if (reclamation == EpochReclaimer::name) {
+        ops = run_reclamation<EpochReclaimer>(values, data_structure, optimization, numThreads, rounds, stall_ms);
+    } else if (reclamation == TaggedRecycling::name) {
+        ops = run_reclamation<TaggedRecycling>(values, data_structure, optimization, numThreads, rounds, stall_ms);
+    } else {
+        cerr << "Error: Invalid reclamation specified." << endl;
+        return;
+    }
+    if (ops == 0) return;
+
+    auto end_time = chrono::high_resolution_clock::now();
+    double seconds = chrono::duration<double>(end_time - start_time).count();
+
+    cout << data_structure << " with " << reclamation << " reclamation, "
+         << numThreads << " threads, " << rounds << " rounds";
+    if (stall_ms > 0) cout << ", one reader stalled for " << stall_ms << " ms";
+    cout << endl;
+    cout << "\033[1mThroughput: \033[32m" << ops / seconds / 1e6 << " Mops/s\033[0m" << endl;
+    cout << "\033[1mPeak RSS: \033[32m" << peak_rss_kb() << " KB\033[0m"
+         << " (" << peak_rss_kb() - rss_before << " KB during the run)" << endl;
+}
+
+/** Batched version of producer_consumer. Each producer cuts its share of
+ *  values into chunks of `batch` and inserts a chunk at a time, consumers
+ *  remove up to `batch` values at a time.
+ *
+ * @param insert Callable inserting the range [first, last) of ints
+ * @param remove Callable removing up to the given number of ints, returning
+ *               how many it removed
+ * @return The number of values moved through the container (inserts + removes)
+ */
+template <typename Insert, typename Remove>
+static long batch_producer_consumer(std::vector<int>& values, int numThreads, int rounds, size_t batch,
+                                    Insert insert, Remove remove) {
+    long total = (long)values.size() * rounds;
+    long window = std::max((long)values.size(), (long)batch * numThreads);
+    atomic<long> inserted(0);
+    atomic<long> removed(0);
+
+    int producers = std::max(numThreads / 2, 1);
+    int consumers = std::max(numThreads - producers, 1);
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < producers; ++i) {
+        threads.push_back(std::thread([&, i]() {
+            std::vector<int> share;
+            for (size_t j = i; j < values.size(); j += producers) {
+                share.push_back(values[j]);
+            }
+            for (int r = 0; r < rounds; ++r) {
+                for (size_t j = 0; j < share.size(); j += batch) {
+                    size_t n = std::min(batch, share.size() - j);
+                    while (inserted.load(RELAXED) - removed.load(RELAXED) >= window) {
+                        std::this_thread::yield(); // Let consumers catch up
+                    }
+                    insert(share.data() + j, share.data() + j + n);
+                    inserted.fetch_add(n, RELAXED);
+                }
+            }
+        }));
+    }
+    for (int i = 0; i < consumers; ++i) {
+        threads.push_back(std::thread([&]() {
+            while (removed.load(RELAXED) < total) {
+                size_t n = remove(batch);
+                if (n > 0) {
+                    removed.fetch_add(n, RELAXED);
+                } else {
+                    std::this_thread::yield(); // Let producers catch up
+                }
+            }
+        }));
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    if (removed.load(RELAXED) != total) {
+        cerr << "Error: Removed " << removed.load() << " values, expected " << total << endl;
+    }
+    return 2 * total;
+}
+
+template <typename Stack>
+static long run_batch_stack(Stack& stack, std::vector<int>& values, int numThreads, int rounds, size_t batch) {
+    return batch_producer_consumer(values, numThreads, rounds, batch,
+                                   [&](const int* first, const int* last) { stack.push_batch(first, last); },
+                                   [&](size_t n) {
+                                       thread_local std::vector<int> out; // Per consumer, reused across calls
+                                       out.clear();
+                                       return stack.pop_n(std::back_inserter(out), n);
+                                   });
+}
+
+template <typename Queue>
+static long run_batch_queue(Queue& queue, std::vector<int>& values, int numThreads, int rounds, size_t batch) {
+    return batch_producer_consumer(values, numThreads, rounds, batch,
+                                   [&](const int* first, const int* last) { queue.enqueue_bulk(first, last); },
+                                   [&](size_t n) {
+                                       thread_local std::vector<int> out;
+                                       out.clear();
+                                       return queue.dequeue_bulk(std::back_inserter(out), n);
+                                   });
+}
+
+/**
+ * @brief Measures the throughput of the batched container operations for
+ *        batch sizes 1, 2, 4, ... 256.
+ *
+ * For the stacks producers insert with push_batch and consumers remove
+ * with pop_n, so a batch of k values costs one CAS on top instead of k.
+ * For the M&S queue enqueue_bulk links a segment with one CAS on the
+ * tail's next pointer and dequeue_bulk moves head over up to k nodes with
+ * one CAS. Batch size 1 is the one-value-per-CAS baseline.
+ *
+ * @param values         Input values inserted on every round
+ * @param data_structure "TS" (with optimization "Elimination" for tstack_e) or "msqueue"
+ * @param numThreads     Total number of producer and consumer threads
+ * @param rounds         Number of passes each producer makes over its values
+ */
+void batch_benchmark(std::vector<int>& values, const std::string& data_structure,
+                     const std::string& optimization, int numThreads, int rounds) {
+    if (data_structure != "TS" && data_structure != "msqueue") {
+        cerr << "Error: The batch benchmark supports TS and msqueue only." << endl;
+        return;
+    }
+    cout << data_structure << (data_structure == "TS" && optimization == "Elimination" ? " with Elimination" : "")
+         << ", " << numThreads << " threads, " << rounds << " rounds" << endl;
+    for (size_t batch = 1; batch <= 256; batch *= 2) {
+        auto start_time = chrono::high_resolution_clock::now();
+        long ops;
+        if (data_structure == "msqueue") {
+            msqueue<int> queue;
+            ops = run_batch_queue(queue, values, numThreads, rounds, batch);
+        } else if (optimization == "Elimination") {
+            tstack_e<int> stack(elimination_array_size(numThreads));
+            ops = run_batch_stack(stack, values, numThreads, rounds, batch);
+        } else {
+            tstack<int> stack;
+            ops = run_batch_stack(stack, values, numThreads, rounds, batch);
+        }
+        auto end_time = chrono::high_resolution_clock::now();
+        double seconds = chrono::duration<double>(end_time - start_time).count();
+        cout << "Batch " << batch << ": \033[1mThroughput: \033[32m" << ops / seconds / 1e6 << " Mops/s\033[0m" << endl;
+    }
+}
+
+/** Runs one producer/consumer configuration on a fresh Queue and prints its throughput */
+template <typename Queue>
+static void run_single_consumer(Queue& queue, const char* name, std::vector<int>& values,
+                                int producers, int rounds) {
+    auto start_time = chrono::high_resolution_clock::now();
+    long ops = producer_consumer(values, producers, 1, rounds,
+                                 [&](int v) { queue.enqueue(v); },
+                                 [&]() { return queue.dequeue(); },
+                                 [](int, const atomic<bool>&) {}, 0);
+    auto end_time = chrono::high_resolution_clock::now();
+    double seconds = chrono::duration<double>(end_time - start_time).count();
+    cout << "  " << name << ": \033[1mThroughput: \033[32m" << ops / seconds / 1e6 << " Mops/s\033[0m" << endl;
+}
+
+/** Runs inserts and removes on one contended container, first from a
+ *  single thread to print the latency of an uncontended operation, then
+ *  side by side from numThreads threads to print the throughput.
+ */
+template <typename Insert, typename Remove>
+static void run_contended(const char* name, std::vector<int>& values, int numThreads, int rounds,
+                            Insert insert, Remove remove) {
+    auto start_time = chrono::high_resolution_clock::now();
+    long ops = producer_consumer(values, 0, 0, rounds, insert, remove, [](int, const atomic<bool>&) {}, 0);
+    auto end_time = chrono::high_resolution_clock::now();
+    double seconds = chrono::duration<double>(end_time - start_time).count();
+    cout << name << ", 1 thread: \033[1mLatency: \033[32m" << seconds * 1e9 / ops << " ns/op\033[0m" << endl;
+
+    start_time = chrono::high_resolution_clock::now();
+    ops = producer_consumer(values, numThreads / 2, numThreads - numThreads / 2, rounds,
+                            insert, remove, [](int, const atomic<bool>&) {}, 0);
+    end_time = chrono::high_resolution_clock::now();
+    seconds = chrono::duration<double>(end_time - start_time).count();
+    cout << name << ", " << numThreads << " threads: \033[1mThroughput: \033[32m" << ops / seconds / 1e6 << " Mops/s\033[0m" << endl;
+}
+
+/**
+ * @brief Measures how often the elimination containers exchange values
+ *        instead of touching the container, with inserts and removes
+ *        running at the same time.
+ *
+ * The array is sized with elimination_array_size and every thread adapts
+ * the range of slots it uses, so the average range shows where the ranges
+ * settled for the thread count. The latency of a single uncontended thread
+ * is printed first, which is what the elimination machinery must not slow down.
+ *
+ * @param values         Input values inserted on every round
+ * @param data_structure "TS" for tstack_e, "SGLStack" for SGLStack_e or "msqueue" for msqueue_e
+ * @param numThreads     Total number of push and pop threads
+ * @param rounds         Number of passes each pushing thread makes over its values
+ * @param choice         How threads pick their slots, see SlotChoice
+ */
+void elimination_benchmark(std::vector<int>& values, const std::string& data_structure, int numThreads, int rounds,
+                           SlotChoice choice) {
+    cout << data_structure << " with Elimination (" << (choice == CPU_SLOT ? "cpu" : "random") << " slots), "
+         << numThreads << " threads, " << rounds << " rounds" << endl;
+    if (data_structure == "TS") {
+        tstack_e<int> stack(elimination_array_size(numThreads), choice);
+        run_contended("tstack_e", values, numThreads, rounds,
+                        [&](int v) { stack.push(v); }, [&]() { return stack.pop(); });
+        print_elimination_stats(stack.eliminationArray.stats(), stack.eliminationArray.size);
+    } else if (data_structure == "SGLStack") {
+        SGLStack_e<int> stack(elimination_array_size(numThreads), choice);
+        run_contended("SGLStack_e", values, numThreads, rounds,
+                        [&](int v) { stack.push(v); }, [&]() { return stack.pop(); });
+        print_elimination_stats(stack.eliminationStats(), stack.eliminationSize());
+    } else if (data_structure == "msqueue") {
+        msqueue_e<int> queue(elimination_array_size(numThreads), choice);
+        run_contended("msqueue_e", values, numThreads, rounds,
+                        [&](int v) { queue.enqueue(v); }, [&]() { return queue.dequeue(); });
+        print_elimination_stats(queue.eliminationArray.stats(), queue.eliminationArray.size);
+    } else {
+        cerr << "Error: The elimination benchmark supports TS, SGLStack and msqueue only." << endl;
+    }
+}
+
+/**
+ * @brief Compares the single-consumer queues with the general MPMC queues.
+ *
+ * 1 producer / 1 consumer: spscqueue, mpscqueue, ringqueue and msqueue.
+ * N producers / 1 consumer, with N = numThreads - 1: mpscqueue and msqueue.
+ *
+ * @param values     Input values inserted on every round
+ * @param numThreads Total number of threads of the N producers / 1 consumer run
+ * @param rounds     Number of passes the producers make over the values
+ */
+void single_consumer_benchmark(std::vector<int>& values, int numThreads, int rounds) {
+    cout << "1 producer / 1 consumer, " << rounds << " rounds" << endl;
+    {
+        spscqueue<int> queue(values.size());
+        run_single_consumer(queue, "spscqueue", values, 1, rounds);
+    }
+    {
+        mpscqueue<int> queue;
+        run_single_consumer(queue, "mpscqueue", values, 1, rounds);
+    }
+    {
+        ringqueue<int> queue(values.size());
+        run_single_consumer(queue, "ringqueue", values, 1, rounds);
+    }
+    {
+        msqueue<int> queue;
+        run_single_consumer(queue, "msqueue", values, 1, rounds);
+    }
+
+    int producers = numThreads > 2 ? numThreads - 1 : 1;
+    cout << producers << " producers / 1 consumer, " << rounds << " rounds" << endl;
+    {
+        mpscqueue<int> queue;
+        run_single_consumer(queue, "mpscqueue", values, producers, rounds);
+    }
+    {
+        msqueue<int> queue;
+        run_single_consumer(queue, "msqueue", values, producers, rounds);
+    }
+}
+
+/** Runs SGLStack or SGLQueue with flat combining and with parallel flat
+ *  combining side by side, and SGLQueue with one combiner per end, for the
+ *  thread counts where a single combiner becomes the bottleneck.
+ */
+void combining_benchmark(std::vector<int>& values, const std::string& data_structure, int numThreads, int rounds) {
+    size_t combiners = parallel_fc_combiners(numThreads);
+    cout << data_structure << " with Flat-combining and Parallel-FC (" << combiners << " combiners), "
+         << numThreads << " threads, " << rounds << " rounds" << endl;
+    if (data_structure == "SGLStack") {
+        SGLStack_FC<int> fc;
+        run_contended("SGLStack_FC", values, numThreads, rounds,
+                      [&](int v) { fc.push(v); }, [&]() { return fc.pop(); });
+        print_combining_stats(fc.combiningStats());
+        SGLStack_PFC<int> pfc(combiners);
+        run_contended("SGLStack_PFC", values, numThreads, rounds,
+                      [&](int v) { pfc.push(v); }, [&]() { return pfc.pop(); });
+        print_combining_stats(pfc.combiningStats());
+    } else if (data_structure == "SGLQueue") {
+        SGLQueue_FC<int> fc;
+        run_contended("SGLQueue_FC", values, numThreads, rounds,
+                      [&](int v) { fc.enqueue(v); }, [&]() { return fc.dequeue(); });
+        print_combining_stats(fc.combiningStats());
+        SGLQueue_PFC<int> pfc(combiners);
+        run_contended("SGLQueue_PFC", values, numThreads, rounds,
+                      [&](int v) { pfc.enqueue(v); }, [&]() { return pfc.dequeue(); });
+        print_combining_stats(pfc.combiningStats());
+        SGLQueue_2FC<int> two_sided;
+        run_contended("SGLQueue_2FC", values, numThreads, rounds,
+                      [&](int v) { two_sided.enqueue(v); }, [&]() { return two_sided.dequeue(); });
+        print_combining_stats(two_sided.combiningStats());
+    } else {
+        cerr << "Error: The combining benchmark supports SGLStack and SGLQueue only." << endl;
+    }
+}
+
+/**
+ * @brief Runs one SGL container with every lock of my_atomics.h and with
+ *        std::mutex, inserts and removes running at the same time.
+ *
+ * A lock that is fast in isolation can hand over badly once its holder
+ * has real work to do and the waiters outnumber the CPUs, so the locks are
+ * compared inside the containers instead of around an empty section.
+ * SGLQueue and SGLStack are the only runs with CriticalSectionTimer. They
+ * also run on std::list next to ChunkedStorage, and print the time the lock
+ * is held with each; the rest of an operation is the acquire and release.
+ *
+ * @param values         Input values inserted on every round
+ * @param data_structure "SGLQueue" or "SGLStack"
+ * @param optimization   "none", "Elimination" (SGLStack) or "Flat-combining",
+ *                       where the lock elects the combiner
+ * @param numThreads     Total number of insert and remove threads
+ * @param rounds         Number of passes each inserting thread makes over its values
+ */
+void lock_benchmark(std::vector<int>& values, const std::string& data_structure,
+                    const std::string& optimization, int numThreads, int rounds) {
+    bool queue = data_structure == "SGLQueue";
+    if ((!queue && data_structure != "SGLStack") ||
+        (optimization != "none" && optimization != "Flat-combining" && (queue || optimization != "Elimination"))) {
+        cerr << "Error: The lock benchmark supports SGLQueue and SGLStack with none or Flat-combining,"
+             << " and SGLStack with Elimination." << endl;
+        return;
+    }
+    cout << data_structure << " with " << optimization << " optimization, " << numThreads << " threads, "
+         << rounds << " rounds" << endl;
+    for (LockKind kind : {MUTEX_LOCK, TAS_LOCK, TTAS_LOCK, TICKET_LOCK, MCS_LOCK}) {
+        string name = data_structure + " (" + lock_name(kind) + ")";
+        with_lock(kind, [&]<typename Lock>() {
+            if (optimization == "Flat-combining") {
+                if (queue) {
+                    SGLQueue_FC<int, FlatCombiner<std::queue<int>, QueueOp<int>, Lock>> fc;
+                    run_contended(name.c_str(), values, numThreads, rounds,
+                                  [&](int v) { fc.enqueue(v); }, [&]() { return fc.dequeue(); });
+                } else {
+                    SGLStack_FC<int, FlatCombiner<std::stack<int>, StackOp<int>, Lock>> fc;
+                    run_contended(name.c_str(), values, numThreads, rounds,
+                                  [&](int v) { fc.push(v); }, [&]() { return fc.pop(); });
+                }
+            } else if (optimization == "Elimination") {
+                SGLStack_e<int, Lock> stack(elimination_array_size(numThreads));
+                run_contended(name.c_str(), values, numThreads, rounds,
+                              [&](int v) { stack.push(v); }, [&]() { return stack.pop(); });
+            } else if (queue) {
+                SGLQueue<int, ChunkedStorage<int>, Lock, CriticalSectionTimer> sgl;
+                run_contended(name.c_str(), values, numThreads, rounds,
+                              [&](int v) { sgl.enqueue(v); }, [&]() { return sgl.dequeue(); });
+                SGLQueue<int, std::list<int>, Lock, CriticalSectionTimer> list;
+                run_contended((name + " std::list").c_str(), values, numThreads, rounds,
+                              [&](int v) { list.enqueue(v); }, [&]() { return list.dequeue(); });
+                print_critical_section_stats(sgl.criticalSectionStats(), list.criticalSectionStats());
+            } else {
+                SGLStack<int, ChunkedStorage<int>, Lock, CriticalSectionTimer> sgl;
+                run_contended(name.c_str(), values, numThreads, rounds,
+                              [&](int v) { sgl.push(v); }, [&]() { return sgl.pop(); });
+                SGLStack<int, std::list<int>, Lock, CriticalSectionTimer> list;
+                run_contended((name + " std::list").c_str(), values, numThreads, rounds,
+                              [&](int v) { list.push(v); }, [&]() { return list.pop(); });
+                print_critical_section_stats(sgl.criticalSectionStats(), list.criticalSectionStats());
+            }
+        });
+    }
+}
+
+/**
+ * @brief Compares the MPMC queues from one lock for both ends to none:
+ *        SGLQueue, twolockqueue, msqueue and faaqueue, with enqueues and
+ *        dequeues running at the same time.
+ *
+ * @param values     Input values enqueued on every round
+ * @param numThreads Total number of enqueue and dequeue threads
+ * @param rounds     Number of passes each enqueueing thread makes over its values
+ * @param lock       Lock of SGLQueue and of both ends of twolockqueue
+ */
+void queue_benchmark(std::vector<int>& values, int numThreads, int rounds, LockKind lock) {
+    cout << "MPMC queues, " << lock_name(lock) << " locks, " << numThreads << " threads, " << rounds << " rounds" << endl;
+    with_lock(lock, [&]<typename Lock>() {
+        {
+            SGLQueue<int, ChunkedStorage<int>, Lock> queue;
+            run_contended("SGLQueue", values, numThreads, rounds,
+                          [&](int v) { queue.enqueue(v); }, [&]() { return queue.dequeue(); });
+        }
+        {
+            twolockqueue<int, Lock> queue;
+            run_contended("twolockqueue", values, numThreads, rounds,
+                          [&](int v) { queue.enqueue(v); }, [&]() { return queue.dequeue(); });
+        }
+    });
+    {
+        msqueue<int> queue;
+        run_contended("msqueue", values, numThreads, rounds,
+                      [&](int v) { queue.enqueue(v); }, [&]() { return queue.dequeue(); });
+    }
+    {
+        faaqueue<int> queue;
+        run_contended("faaqueue", values, numThreads, rounds,
+                      [&](int v) { queue.enqueue(v); }, [&]() { return queue.dequeue(); });
+    }
+}
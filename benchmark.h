@@ -0,0 +1,42 @@
+/*****************************************************************
+ * @author Suraj Ajjampur
+ * @file   benchmark.h
+ *
+ * @brief This C++ header file declares the long-running benchmarks that
+ *        complement the per-container tests. Unlike the tests, which push
+ *        the input once and check the result, these keep producers and
+ *        consumers running for many rounds and report throughput and the
+ *        memory footprint of the process.
+ *
+ * @date 16 Oct 2026
+********************************************************************/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "elimination.h" // SlotChoice
+#include <string>
+#include <vector>
+
+long peak_rss_kb();
+
+void reclamation_benchmark(std::vector<int>& values, const std::string& data_structure,
+                           const std::string& optimization, const std::string& reclamation,
+                           int numThreads, int rounds, int stall_ms);
+
+void batch_benchmark(std::vector<int>& values, const std::string& data_structure,
+                     const std::string& optimization, int numThreads, int rounds);
+
+void single_consumer_benchmark(std::vector<int>& values, int numThreads, int rounds);
+
+void elimination_benchmark(std::vector<int>& values, const std::string& data_structure, int numThreads, int rounds,
+                           SlotChoice choice);
+
+void combining_benchmark(std::vector<int>& values, const std::string& data_structure, int numThreads, int rounds);
+
+void lock_benchmark(std::vector<int>& values, const std::string& data_structure,
+                    const std::string& optimization, int numThreads, int rounds);
+
+void queue_benchmark(std::vector<int>& values, int numThreads, int rounds, LockKind lock);
+
+#endif // BENCHMARK_H
@@ -3,101 +3,17 @@
  * @file   elimination.cpp
  * 
  * @brief This C++ source file implements stacks using the 
- *        elimination method in order to deal with contention issues.
+ *        elimination method in order to deal with contention issues,
+ *        and tests the M&S queue with elimination.
  * 
  * @date 15 Dec 2023
 ********************************************************************/
 
 #include "elimination.h"
-#define ELIMINATION_ARRAY_SIZE 5
-
-bool tstack_e::tryElimination(int& val, bool isPush) {
-    // Select a random slot in the elimination array
-    int slotIndex = getRandomSlotIndex();
-    EliminationSlot& slot = eliminationArray.slots[slotIndex];
-
-    if (!slot.active.load(ACQUIRE)) {
-        // Slot is empty, try to place operation there
-        int expected = 0;
-        if (cas(slot.value,expected, val, ACQ_REL)) {
-            slot.isPush.store(isPush, RELEASE);
-            slot.active.store(true, RELEASE);
-
-            // Wait for a short duration for a match
-            std::this_thread::sleep_for(std::chrono::milliseconds(10)); // You can adjust this duration
-
-            if (slot.active.load(ACQUIRE)) {
-                // No operation combined, remove the operation
-                slot.active.store(false, RELEASE);
-                return false; // Failed to eliminate, need to retry stack operation
-            } else {
-                // Operation combined
-                if (!isPush) {
-                    val = slot.value.load(RELAXED); // For pop, update the value
-                }
-                return true;
-            }
-        }
-    } else if (slot.isPush.load(ACQUIRE) != isPush) {
-        // Found an opposite operation, try to combine
-        int oppositeValue = slot.value.load(ACQUIRE);
-        if (cas(slot.active,true, false, ACQ_REL)) {
-            // Successfully exchanged
-            if (!isPush) {
-                val = oppositeValue; // For pop, update the value to the pushed value
-            }
-            return true;
-        }
-    }
-
-    // Slot unusable or operation not combined, return false
-    return false;
-}
-
-
-void tstack_e::push(int val) {
-    node* n = new node(val);
-    node* old_top;
-    while (true) {
-        old_top = top.load(ACQUIRE);
-        n->down.store(old_top, RELAXED);
-        if (cas(top, old_top, n, ACQ_REL)) {
-            break; // Successfully pushed
-        } else {
-            // Attempt to use the elimination array to relieve contention
-            if (!tryElimination(val, true)) {
-                continue; // Retry stack operation if elimination fails
-            }
-            break; // Successfully exchanged in elimination array
-        }
-    }
-}
-
-int tstack_e::pop() {
-    while (true) {
-        node* t = top.load(ACQUIRE);
-        if (t == nullptr) {
-            return -1; // Stack is empty
-        }
-
-        node* n = t->down.load(RELAXED);
-        int v = t->val.load(RELAXED);
-
-        if (cas(top, t, n, ACQ_REL)) {
-            //delete t; // Successfully popped
-            return v;
-        } else {
-            // Attempt to use the elimination array
-            int result;
-            if (!tryElimination(result, false)) {
-                continue; // Retry stack operation if elimination fails
-            }
-            return result; // Successfully exchanged in elimination array
-        }
-    }
-}
+#include <numeric>
+#include <random>
 
-void thread_function(tstack_e& stack, bool isPushThread, int numOps) {
+void thread_function(tstack_e<int>& stack, bool isPushThread, int numOps) {
     std::random_device rd;
     std::mt19937 gen(rd());
     std::uniform_int_distribution<> dis(0, 1000);
@@ -116,7 +32,7 @@ void thread_function(tstack_e& stack, bool isPushThread, int numOps) {
 void test_ts_elimination(void){
 
     // Specifying the size of the elimination array to 10
-    tstack_e stack(12);
+    tstack_e<int> stack(12);
     const int numThreads = 128;
     const int numOps = 10000; // Number of operations per thread
 
@@ -141,19 +57,33 @@ void test_ts_elimination(void){
 }
 
 
-void Push(tstack_e& stack, int val) {
+/**
+ * @brief Prints how often elimination worked and how far threads spread
+ *        over the array, on average over all attempts.
+ *
+ * @param stats Counters of the run, see EliminationArray::stats
+ * @param size  Number of slots of the array
+ */
+void print_elimination_stats(const EliminationStats& stats, int size) {
+    std::cout << "Elimination: " << stats.hits << "/" << stats.attempts << " attempts exchanged ("
+              << 100 * stats.hit_rate() << "%), " << stats.timeouts << " timeouts, "
+              << stats.collisions << " collisions, " << stats.rejected << " rejected, average range " << stats.average_range()
+              << " of " << size << " slots" << std::endl;
+}
+
+void Push(tstack_e<int>& stack, int val) {
     stack.push(val);
 }
 
-void Pop(tstack_e& stack, std::atomic<int>& popCount) {
-    int val = stack.pop();
-    if ( val != -1) {
+void Pop(tstack_e<int>& stack, std::atomic<int>& popCount) {
+    int val;
+    if (stack.try_pop(val)) {
         popCount.fetch_add(1, RELAXED);
     }else{DEBUG_MSG("Stack is empty");}
 }
 
-void treiber_stack_elimination_test(std::vector<int>& values, int numThreads) {
-    tstack_e stack(ELIMINATION_ARRAY_SIZE);
+void treiber_stack_elimination_test(std::vector<int>& values, int numThreads, SlotChoice choice) {
+    tstack_e<int> stack(elimination_array_size(numThreads), choice);
     std::atomic<int> popCount(0);
 
     if (numThreads > 1) {
@@ -203,120 +133,121 @@ void treiber_stack_elimination_test(std::vector<int>& values, int numThreads) {
     } else {
         std::cout << "Test for Treiber stack with Elimination optimization passed" << std::endl;
     }
+    print_elimination_stats(stack.eliminationArray.stats(), stack.eliminationArray.size);
 }
 
 
 
-void SGLStack_e::push(int val) {
-    if (!sgl.try_lock()) {
-        if (!tryElimination(val, true)) {
-            std::lock_guard<std::mutex> lock(sgl);
-            q.push_back(val);
-        }
-    } else {
-        std::lock_guard<std::mutex> lock(sgl, std::adopt_lock);
-        q.push_back(val);
-    }
+template <typename Stack>
+void concurrentSGLStackPush(Stack& stack, int val) {
+    stack.push(val);
 }
 
-int SGLStack_e::pop() {
-    if (!sgl.try_lock()) {
-        int val;
-        if (!tryElimination(val, false)) {
-            std::lock_guard<std::mutex> lock(sgl);
-            if (q.empty()) return -1;
-            int ret = q.back();
-            q.pop_back();
-            return ret;
-        } else {
-            return val;
-        }
-    } else {
-        std::lock_guard<std::mutex> lock(sgl, std::adopt_lock);
-        if (q.empty()) return -1;
-        int ret = q.back();
-        q.pop_back();
-        return ret;
+template <typename Stack>
+void concurrentSGLStackPop(Stack& stack, std::atomic<int>& popCount) {
+    if (stack.pop()) {
+        popCount.fetch_add(1, RELAXED);
     }
 }
 
-bool SGLStack_e::tryElimination(int& val, bool isPush) {
-    // Ensure the random slot selection function is defined
-    int slotIndex = eliminationArray.getRandomSlotIndex();
-    EliminationSlot& slot = eliminationArray.slots[slotIndex];
-
-    if (!slot.active.load(ACQUIRE)) {
-        int expected = 0;
-        if (std::atomic_compare_exchange_strong(&slot.value, &expected, val)) {
-            slot.isPush.store(isPush, RELEASE);
-            slot.active.store(true, RELEASE);
-
-            std::this_thread::sleep_for(std::chrono::milliseconds(10)); // Adjustable duration
-
-            if (slot.active.load(ACQUIRE)) {
-                slot.active.store(false, RELEASE);
-                return false; // Failed to eliminate, retry stack operation
-            } else {
-                if (!isPush) {
-                    val = slot.value.load(RELAXED); // For pop, update the value
+void sgl_stack_elimination_test(std::vector<int>& values, int numThreads, SlotChoice choice, LockKind lock) {
+    with_lock(lock, [&]<typename Lock>() {
+        SGLStack_e<int, Lock> stack(elimination_array_size(numThreads), choice);
+        std::atomic<int> popCount(0);
+        std::vector<std::thread> threads;
+
+        int halfNumThreads = numThreads / 2;
+
+        // Concurrent pushes
+        for (int i = 0; i < halfNumThreads; ++i) {
+            threads.push_back(std::thread([&stack, &values, i, halfNumThreads]() {
+                for (int j = i; j < values.size(); j += halfNumThreads) {
+                    concurrentSGLStackPush(stack, values[j]);
                 }
-                return true; // Operation combined
-            }
+            }));
         }
-    } else if (slot.isPush.load(ACQUIRE) != isPush) {
-        bool expected = true;
-        if (cas(slot.active, expected, false, ACQ_REL)) {
-            if (!isPush) {
-                val = slot.value.load(ACQUIRE);
-            }
-            return true; // Successfully exchanged
+
+        #ifdef DEBUG_MODE
+        DEBUG_MSG("Begin Pop");
+        #endif
+
+        // Wait for all threads to complete
+        for (auto& t : threads) {
+            t.join();
         }
-    }
+        threads.clear(); // Clear the threads vector after join
 
-    return false; // Slot unusable or operation not combined
-}
+        // Concurrent pops
+        for (int i = 0; i < halfNumThreads; ++i) {
+            threads.push_back(std::thread([&stack, &popCount, i, halfNumThreads, &values]() {
+                for (int j = i; j < values.size(); j += halfNumThreads) {
+                    concurrentSGLStackPop(stack, popCount);
+                }
+            }));
+        }
 
-void concurrentSGLStackPush(SGLStack_e& stack, int val) {
-    stack.push(val);
-}
+        for (auto& t : threads) {
+            t.join();
+        }
 
-void concurrentSGLStackPop(SGLStack_e& stack, std::atomic<int>& popCount) {
-    if (stack.pop() != -1) {
-        popCount.fetch_add(1, RELAXED);
-    }
+        if (popCount.load(RELAXED) != values.size()) {
+            std::cerr << "Error: The number of successful pops does not match the number of pushes." << std::endl;
+            std::cerr << "Pops: " << popCount << ", Pushes: " << values.size() << std::endl;
+        } else {
+            std::cout << "Test for SGL stack passed with Elimination optimization (" << lock_name(lock) << " lock)" << std::endl;
+        }
+        print_elimination_stats(stack.eliminationStats(), stack.eliminationSize());
+    });
 }
 
-void sgl_stack_elimination_test(std::vector<int>& values, int numThreads) {
-    SGLStack_e stack(ELIMINATION_ARRAY_SIZE);
-    std::atomic<int> popCount(0);
+/**
+ * @brief Tests the M&S queue with elimination, enqueues and dequeues
+ *        running at the same time.
+ *
+ * Half of the threads enqueue the indices of their share of the values,
+ * the other half dequeue until every index has come out. Besides the sum,
+ * each consumer checks that the indices of any one producer come out in
+ * the order that producer enqueued them, which elimination must not break.
+ *
+ * @param values A vector of integers whose indices are enqueued into the queue.
+ * @param numThreads The total number of threads to be used for concurrent enqueue and dequeue operations.
+ * @param choice How threads pick their elimination slots.
+ */
+void ms_queue_elimination_test(std::vector<int>& values, int numThreads, SlotChoice choice) {
+    msqueue_e<int> queue(elimination_array_size(numThreads), choice);
+    std::atomic<int> sum(0);
+    std::atomic<size_t> dequeued(0);
+    std::atomic<bool> ordered(true);
     std::vector<std::thread> threads;
 
     int halfNumThreads = numThreads / 2;
+    if (halfNumThreads == 0) halfNumThreads = 1;
 
-    // Concurrent pushes
+    // Concurrent enqueues, producer i enqueues i, i + halfNumThreads, ...
     for (int i = 0; i < halfNumThreads; ++i) {
-        threads.push_back(std::thread([&stack, &values, i, halfNumThreads]() {
-            for (int j = i; j < values.size(); j += halfNumThreads) {
-                concurrentSGLStackPush(stack, values[j]);
+        threads.push_back(std::thread([&queue, &values, i, halfNumThreads]() {
+            for (size_t j = i; j < values.size(); j += halfNumThreads) {
+                queue.enqueue((int)j);
             }
         }));
     }
 
-    #ifdef DEBUG_MODE
-    DEBUG_MSG("Begin Pop");
-    #endif
-
-    // Wait for all threads to complete
-    for (auto& t : threads) {
-        t.join();
-    }
-    threads.clear(); // Clear the threads vector after join
-
-    // Concurrent pops
+    // Concurrent dequeues, until all indices are out
     for (int i = 0; i < halfNumThreads; ++i) {
-        threads.push_back(std::thread([&stack, &popCount, i, halfNumThreads, &values]() {
-            for (int j = i; j < values.size(); j += halfNumThreads) {
-                concurrentSGLStackPop(stack, popCount);
+        threads.push_back(std::thread([&queue, &values, &sum, &dequeued, &ordered, halfNumThreads]() {
+            std::vector<int> last(halfNumThreads, -1); // Last index seen from each producer
+            int j;
+            while (dequeued.load(RELAXED) < values.size()) {
+                if (queue.try_dequeue(j)) {
+                    if (j <= last[j % halfNumThreads]) {
+                        ordered.store(false, RELAXED);
+                    }
+                    last[j % halfNumThreads] = j;
+                    sum.fetch_add(values[j], RELAXED);
+                    dequeued.fetch_add(1, RELAXED);
+                } else {
+                    std::this_thread::yield();
+                }
             }
         }));
     }
@@ -325,10 +256,14 @@ void sgl_stack_elimination_test(std::vector<int>& values, int numThreads) {
         t.join();
     }
 
-    if (popCount.load(RELAXED) != values.size()) {
-        std::cerr << "Error: The number of successful pops does not match the number of pushes." << std::endl;
-        std::cerr << "Pops: " << popCount << ", Pushes: " << values.size() << std::endl;
+    int expectedSum = std::accumulate(values.begin(), values.end(), 0);
+    if (sum != expectedSum) {
+        std::cerr << "Error: The sum of dequeued values does not match the expected sum." << std::endl;
+        std::cerr << "Sum: " << sum << ", Expected: " << expectedSum << std::endl;
+    } else if (!ordered.load()) {
+        std::cerr << "Error: Values of one producer were dequeued out of order." << std::endl;
     } else {
-        std::cout << "Test for SGL stack passed with Elimination optimization" << std::endl;
+        std::cout << "Test for M&S queue with Elimination optimization passed !" << std::endl;
     }
+    print_elimination_stats(queue.eliminationArray.stats(), queue.eliminationArray.size);
 }
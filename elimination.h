@@ -4,6 +4,7 @@
  * 
  * @brief This C++ header file implements Trieber stack using the 
  *        elimination method in order to deal with contention issues.
+ *        The M&S queue uses the same array with a FIFO-safe pairing rule.
  * 
  * @date 15 Dec 2023
 ********************************************************************/
@@ -12,95 +13,929 @@
 #define ELIMINATION_H
 
 #include "my_atomics.h"
+#include "reclamation.h"
+#include "node_pool.h"
+#include <algorithm>
 #include <cstddef>  // for std::uintptr_t
 #include <assert.h>
 #include <atomic>
 #include <vector>
-#include <random> // For random number generation
 #include <chrono>
 #include <thread>
 #include <list>
+#include <mutex>
+#include <optional>
+#include <sched.h> // sched_getcpu
 
+/** One exchange slot of an elimination array
+ *
+ * The slot is driven by a single state word so that the kind of the
+ * waiting operation and the ownership of the value storage change
+ * together:
+ *
+ *   EMPTY -> WRITING -> PUSH_WAITING / POP_WAITING    (offer)
+ *   *_WAITING -> BUSY -> DONE -> EMPTY                 (partner, then offerer)
+ *   *_WAITING -> BUSY -> REJECTED -> EMPTY             (partner refused, then offerer)
+ *   *_WAITING -> WRITING -> EMPTY                      (offer withdrawn)
+ *
+ * A value sits in the slot while a push offer waits, or after a push
+ * partner handed it to a waiting pop. Whoever moved the state to WRITING
+ * or BUSY owns the storage until its next store. The tag of a push offer
+ * is written with its value.
+ */
+template <typename T>
+struct EliminationSlot {
+    enum State : int { EMPTY, WRITING, PUSH_WAITING, POP_WAITING, BUSY, DONE, REJECTED };
+    std::atomic<int> state;
+    uint64_t tag; // Of the waiting push, see EliminationArray::tryPush
+    NodeValue<T> value;
+
+    EliminationSlot() : state(EMPTY), tag(0) {}
+};
+
+// Bounds and starting point of the spin window of an offer, in pause iterations
+#define ELIMINATION_SPIN_MIN 64
+#define ELIMINATION_SPIN_MAX 16384
+#define ELIMINATION_SPIN_INIT 1024
+// An offer yields its time slice this often, so that a partner sharing the CPU can arrive
+#define ELIMINATION_YIELD_EVERY 256
+// Timeouts in a row after which a thread halves its elimination range
+#define ELIMINATION_SHRINK_AFTER 2
+
+// Smallest elimination array the tests and benchmarks use
+#define ELIMINATION_ARRAY_MIN 5
+// Slots around its home slot a thread picks from with CPU_SLOT
+#define ELIMINATION_CPU_SPREAD 2
+
+/** How a thread picks a slot within its range */
+enum SlotChoice {
+    RANDOM_SLOT, // Uniformly at random
+    CPU_SLOT     // Near a home slot given by the CPU it runs on, so that threads
+                 // on neighbouring CPUs meet in slots their shared cache holds
+};
+
+/** Per-thread xorshift64* generator. Each thread has its own state, so
+ *  picking a slot touches no shared cache line.
+ */
+inline uint32_t thread_random() {
+    thread_local uint64_t state = 0;
+    if (state == 0) {
+        // Different for every live thread and every run, never 0
+        state = ((uint64_t)(uintptr_t)&state ^ (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count()) | 1;
+    }
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return (uint32_t)((state * 2685821657736338717ULL) >> 32);
+}
+
+/** @return A number in [0, n), without a division */
+inline int thread_random(int n) {
+    return (int)(((uint64_t)thread_random() * (uint64_t)n) >> 32);
+}
+
+/** Counters of the elimination attempts on one array, for reporting */
+struct EliminationStats {
+    long attempts;   // Calls of tryPush/tryPop
+    long hits;       // Attempts that exchanged a value
+    long timeouts;   // Offers withdrawn because no partner came
+    long collisions; // Slots found taken by another offer or exchange
+    long rejected;   // Partners found but refused, see EliminationArray::tryPush
+    long range_sum;  // Sum over attempts of the range the slot was picked from
+
+    double hit_rate() const { return attempts ? (double)hits / attempts : 0; }
+    double average_range() const { return attempts ? (double)range_sum / attempts : 0; }
+};
+
+/** Enough slots for every pair of threads to meet in its own one. Threads
+ *  only spread over as many of them as the run needs, see EliminationArray.
+ */
+inline int elimination_array_size(int numThreads) {
+    return std::max(ELIMINATION_ARRAY_MIN, numThreads / 2);
+}
+
+void print_elimination_stats(const EliminationStats& stats, int size);
+
+/** Array of exchange slots shared by the push and pop of a stack
+ *
+ * An offer spins for a partner instead of sleeping. How long it spins
+ * follows how long partners have recently taken to show up: a hit pulls
+ * the window towards twice the observed wait, a timeout shrinks it, so
+ * offers stop burning cycles when nobody is coming and wait longer when
+ * partners arrive late but do arrive.
+ *
+ * Each thread also only picks slots among the first `range` of them, as in
+ * Hendler, Shavit and Yerushalmi's elimination backoff stack. The range
+ * doubles when the picked slot is taken by someone else (too many threads
+ * for too few slots) and halves after ELIMINATION_SHRINK_AFTER timeouts in
+ * a row (too few threads spread over too many slots, missing each other).
+ * The range is per thread and starts at 1, so the array can be sized for
+ * the largest thread count and a small run still meets in a few slots.
+ * Within the range a slot is picked at random or near the thread's CPU,
+ * see SlotChoice.
+ */
+template <typename T>
+class EliminationArray {
+public:
+    std::vector<EliminationSlot<T>> slots;
+    const int size;
+    const SlotChoice choice;
+    const int cpus; // CPUs mapped onto the range with CPU_SLOT
+
+    EliminationArray(int size, SlotChoice choice = RANDOM_SLOT)
+        : slots(size), size(size), choice(choice), cpus(std::max(1u, std::thread::hardware_concurrency())),
+          spin_window(ELIMINATION_SPIN_INIT), attempts(0), hits(0), timeouts(0), collisions(0), rejected(0), range_sum(0) {}
+
+    int getSlotIndex(int range);
+
+    bool tryPush(T& val);
+    bool tryPop(std::optional<T>& out);
+    template <typename Accept>
+    bool tryPush(T& val, uint64_t tag, Accept accept);
+    template <typename Accept>
+    bool tryPop(std::optional<T>& out, Accept accept);
+    EliminationStats stats() const;
+
+private:
+    enum Outcome { HIT, TIMEOUT, COLLISION, REJECT };
+
+    /** The calling thread's range, reset when it moves to another array */
+    struct Range {
+        const EliminationArray* owner = nullptr;
+        int range = 1;
+        int timeouts = 0; // In a row
+    };
+    Range& localRange();
+
+    // Written once per offer, kept away from the slots
+    alignas(CACHE_LINE_SIZE) std::atomic<int> spin_window;
+    // Statistics, only written after an attempt is over
+    alignas(CACHE_LINE_SIZE) std::atomic<long> attempts, hits, timeouts, collisions, rejected, range_sum;
+
+    Outcome offer(EliminationSlot<T>& slot, int waiting, T* val, uint64_t tag, std::optional<T>* out);
+    bool record(Range& r, Outcome outcome);
+    void adapt(bool hit, int waited);
+};
+
+/** @return A slot among the first range ones, picked as choice says */
+template <typename T>
+int EliminationArray<T>::getSlotIndex(int range) {
+    if (choice == CPU_SLOT) {
+        int cpu = sched_getcpu();
+        if (cpu < 0) cpu = 0;
+        int home = (int)((long)(cpu % cpus) * range / cpus); // Neighbouring CPUs, neighbouring slots
+        return (home + thread_random(std::min(range, ELIMINATION_CPU_SPREAD))) % range;
+    }
+    return thread_random(range);
+}
+
+template <typename T>
+typename EliminationArray<T>::Range& EliminationArray<T>::localRange() {
+    thread_local Range r;
+    if (r.owner != this) {
+        r = Range();
+        r.owner = this;
+    }
+    if (r.range > size) {
+        r.range = size;
+    }
+    return r;
+}
+
+/** Moves the thread's range after an attempt and counts it
+ *
+ * @return true if the attempt exchanged a value
+ */
+template <typename T>
+bool EliminationArray<T>::record(Range& r, Outcome outcome) {
+    attempts.fetch_add(1, RELAXED);
+    range_sum.fetch_add(r.range, RELAXED);
+    switch (outcome) {
+    case HIT:
+        hits.fetch_add(1, RELAXED);
+        r.timeouts = 0;
+        return true;
+    case TIMEOUT:
+        timeouts.fetch_add(1, RELAXED);
+        if (++r.timeouts >= ELIMINATION_SHRINK_AFTER) {
+            r.range = std::max(1, r.range / 2); // Partners are missing each other, spread less
+            r.timeouts = 0;
+        }
+        return false;
+    case COLLISION:
+        collisions.fetch_add(1, RELAXED);
+        r.range = std::min(size, r.range * 2); // Slots are crowded, spread more
+        r.timeouts = 0;
+        return false;
+    case REJECT:
+        rejected.fetch_add(1, RELAXED); // Partners do meet, the range is fine
+        return false;
+    }
+    return false;
+}
+
+/** @return A snapshot of the counters, exact once no thread is using the array */
+template <typename T>
+EliminationStats EliminationArray<T>::stats() const {
+    return EliminationStats{attempts.load(RELAXED), hits.load(RELAXED), timeouts.load(RELAXED),
+                            collisions.load(RELAXED), rejected.load(RELAXED), range_sum.load(RELAXED)};
+}
+
+/** Offers val to a concurrent pop, any pop will do.
+ *
+ * @param val Moved out on success, left in place otherwise
+ * @return true if a pop took val
+ */
+template <typename T>
+bool EliminationArray<T>::tryPush(T& val) {
+    return tryPush(val, 0, [](uint64_t) { return true; });
+}
+
+/** Takes a value from a concurrent push, any push will do.
+ *
+ * @param out Receives the pushed value on success
+ * @return true if a push was eliminated
+ */
+template <typename T>
+bool EliminationArray<T>::tryPop(std::optional<T>& out) {
+    return tryPop(out, [](uint64_t) { return true; });
+}
+
+/** Offers val to a concurrent pop, if accept agrees to the pairing.
+ *
+ * Whichever side completes the exchange calls accept(tag) once it holds
+ * the slot, so after the offer was made, and the exchange only goes ahead
+ * if it returns true. The FIFO queue uses this to pair a dequeue only with
+ * an enqueue whose value would already be at the head.
+ *
+ * @param val    Moved out on success, left in place otherwise
+ * @param tag    Passed to accept, whoever calls it
+ * @param accept Called with tag, by this thread or by the waiting pop's
+ * @return true if a pop took val
+ */
+template <typename T>
+template <typename Accept>
+bool EliminationArray<T>::tryPush(T& val, uint64_t tag, Accept accept) {
+    // Select a random slot within this thread's range
+    Range& r = localRange();
+    EliminationSlot<T>& slot = slots[getSlotIndex(r.range)];
+    int s = slot.state.load(ACQUIRE);
+    if (s == EliminationSlot<T>::EMPTY) {
+        return record(r, offer(slot, EliminationSlot<T>::PUSH_WAITING, &val, tag, nullptr));
+    }
+    if (s == EliminationSlot<T>::POP_WAITING && cas(slot.state, s, (int)EliminationSlot<T>::BUSY, ACQ_REL)) {
+        if (!accept(tag)) {
+            slot.state.store(EliminationSlot<T>::REJECTED, RELEASE); // The pop withdraws
+            return record(r, REJECT);
+        }
+        // Found a waiting pop, hand it the value
+        slot.value.emplace(std::move(val));
+        slot.state.store(EliminationSlot<T>::DONE, RELEASE);
+        return record(r, HIT);
+    }
+    // Slot unusable, return false
+    return record(r, COLLISION);
+}
+
+/** Takes a value from a concurrent push, if accept agrees to the pairing.
+ *
+ * @param out    Receives the pushed value on success
+ * @param accept Called with the push's tag, see tryPush
+ * @return true if a push was eliminated
+ */
+template <typename T>
+template <typename Accept>
+bool EliminationArray<T>::tryPop(std::optional<T>& out, Accept accept) {
+    Range& r = localRange();
+    EliminationSlot<T>& slot = slots[getSlotIndex(r.range)];
+    int s = slot.state.load(ACQUIRE);
+    if (s == EliminationSlot<T>::EMPTY) {
+        // A push that finds this offer calls its own accept
+        return record(r, offer(slot, EliminationSlot<T>::POP_WAITING, nullptr, 0, &out));
+    }
+    if (s == EliminationSlot<T>::PUSH_WAITING && cas(slot.state, s, (int)EliminationSlot<T>::BUSY, ACQ_REL)) {
+        if (!accept(slot.tag)) {
+            slot.state.store(EliminationSlot<T>::REJECTED, RELEASE); // The push takes its value back
+            return record(r, REJECT);
+        }
+        // Found a waiting push, take its value
+        out.emplace(slot.value.take());
+        slot.state.store(EliminationSlot<T>::DONE, RELEASE);
+        return record(r, HIT);
+    }
+    return record(r, COLLISION);
+}
+
+/** Parks an operation in an empty slot and waits for a partner. */
+template <typename T>
+typename EliminationArray<T>::Outcome EliminationArray<T>::offer(EliminationSlot<T>& slot, int waiting, T* val, uint64_t tag, std::optional<T>* out) {
+    int expected = EliminationSlot<T>::EMPTY;
+    if (!cas(slot.state, expected, (int)EliminationSlot<T>::WRITING, ACQ_REL)) {
+        return COLLISION; // Someone else took the slot first
+    }
+    if (val != nullptr) {
+        slot.value.emplace(std::move(*val));
+        slot.tag = tag;
+    }
+    slot.state.store(waiting, RELEASE);
+
+    // Spin for a match, for as long as partners have recently needed to show up
+    const int window = spin_window.load(RELAXED);
+    int waited = 0;
+    while (waited < window && slot.state.load(ACQUIRE) == waiting) {
+        if (++waited % ELIMINATION_YIELD_EVERY == 0) {
+            std::this_thread::yield();
+        } else {
+            __builtin_ia32_pause();
+        }
+    }
+
+    expected = waiting;
+    if (cas(slot.state, expected, (int)EliminationSlot<T>::WRITING, ACQ_REL)) {
+        // No operation combined, withdraw the offer
+        if (val != nullptr) {
+            *val = slot.value.take();
+        }
+        slot.state.store(EliminationSlot<T>::EMPTY, RELEASE);
+        adapt(false, waited);
+        return TIMEOUT; // Failed to eliminate, need to retry stack operation
+    }
+    adapt(true, waited);
+    // A partner is in the slot, wait for it to finish the exchange. It may
+    // have lost its CPU in the middle, so yield now and then like above
+    int done;
+    int spins = 0;
+    while ((done = slot.state.load(ACQUIRE)) != EliminationSlot<T>::DONE && done != EliminationSlot<T>::REJECTED) {
+        if (++spins % ELIMINATION_YIELD_EVERY == 0) {
+            std::this_thread::yield();
+        } else {
+            __builtin_ia32_pause();
+        }
+    }
+    if (done == EliminationSlot<T>::REJECTED) {
+        // The partner refused the pairing, the value never left the slot
+        if (val != nullptr) {
+            *val = slot.value.take();
+        }
+        slot.state.store(EliminationSlot<T>::EMPTY, RELEASE);
+        return REJECT;
+    }
+    if (out != nullptr) {
+        out->emplace(slot.value.take());
+    }
+    slot.state.store(EliminationSlot<T>::EMPTY, RELEASE);
+    return HIT;
+}
+
+/** Moves the spin window after an offer
+ *
+ * @param hit    Whether a partner showed up
+ * @param waited Pause iterations spent waiting for it
+ */
+template <typename T>
+void EliminationArray<T>::adapt(bool hit, int waited) {
+    int w = spin_window.load(RELAXED);
+    int next;
+    if (hit) {
+        next = w + (2 * waited + ELIMINATION_SPIN_MIN - w) / 4; // Towards twice the observed wait
+    } else {
+        next = w - w / 8; // Nobody came within the window, spin less next time
+    }
+    next = std::min(std::max(next, ELIMINATION_SPIN_MIN), ELIMINATION_SPIN_MAX);
+    if (next != w) {
+        spin_window.store(next, RELAXED); // A lost update only delays the adaptation
+    }
+}
+
+/** Treiber stack with an elimination array
+ *
+ * @tparam T         Type of the values, only needs to be movable
+ * @tparam Reclaimer Memory reclamation scheme used for popped nodes
+ *                   (see reclamation.h)
+ */
+template <typename T, typename Reclaimer = DefaultReclaimer>
 class tstack_e {
 public:
-    struct node {
-        std::atomic<int> val;    // Data variable of the node
+    struct node : PoolAllocated<node> { // Allocated from the per-thread node pool
+        NodeValue<T> val;        // Data variable of the node, stored inline
         std::atomic<node*> down; // This is like a next pointer of a node in LIFO
-        node(int v) : val(v), down(nullptr) {} // Constructor of node
+        template <typename U>
+        node(U&& v) : down(nullptr) { val.emplace(std::forward<U>(v)); } // Constructor of node
     };
 
-    struct EliminationSlot {
-        std::atomic<int> value;
-        std::atomic<bool> active;
-        std::atomic<bool> isPush; // True for push, false for pop
+    atomic_tagged<node> top; // {pointer, counter} pair swapped with a 16-byte CAS
+    EventCount nonempty;     // Consumers parked in pop_wait/try_pop_for
+    EliminationArray<T> eliminationArray;
 
-        EliminationSlot() : value(0), active(false), isPush(false) {}
-    };
+    tstack_e(int eliminationSize, SlotChoice choice = RANDOM_SLOT) : eliminationArray(eliminationSize, choice) {} // Constructor
+    ~tstack_e();
 
-    class EliminationArray {
-    public:
-        std::vector<EliminationSlot> slots;
-        const int size;
+    void push(T val); 
+    bool try_pop(T& out);
+    std::optional<T> pop();
+    T pop_wait();
+    template <typename Rep, typename Period>
+    std::optional<T> try_pop_for(const std::chrono::duration<Rep, Period>& timeout);
 
-        EliminationArray(int size) : size(size), slots(size) {}
-    };
+    template <typename It>
+    void push_batch(It first, It last);
+    template <typename OutIt>
+    size_t pop_all(OutIt out);
+    template <typename OutIt>
+    size_t pop_n(OutIt out, size_t n);
 
-    atomic<node*> top; // Now an atomic pointer, not just a pointer to node
-    EliminationArray eliminationArray;
+private:
+    template <typename OutIt>
+    size_t drain(node* chain, OutIt out);
+};
 
-    tstack_e(int eliminationSize) : eliminationArray(eliminationSize) {} // Constructor
+/** Frees the nodes still on the stack. Must not run concurrently with
+ *  any other operation.
+ */
+template <typename T, typename Reclaimer>
+tstack_e<T, Reclaimer>::~tstack_e() {
+    node* t = top.load(RELAXED).ptr;
+    while (t != nullptr) {
+        node* n = t->down.load(RELAXED);
+        t->val.destroy();
+        delete t;
+        t = n;
+    }
+}
 
-    void push(int val); 
-    int pop();
-    bool tryElimination(int& val, bool isPush);
-    
-    // Random number generator for choosing a slot in the elimination array
-    std::mt19937 rng{std::random_device{}()};
-    int getRandomSlotIndex() {
-        std::uniform_int_distribution<int> dist(0, eliminationArray.size - 1);
-        return dist(rng);
+template <typename T, typename Reclaimer>
+void tstack_e<T, Reclaimer>::push(T val) {
+    node* n = new node(std::move(val));
+    tagged_ptr<node> old_top;
+    while (true) {
+        old_top = top.load(ACQUIRE);
+        n->down.store(old_top.ptr, RELAXED);
+        if (cas(top, old_top, n)) {
+            nonempty.notify();
+            break; // Successfully pushed
+        } else {
+            // Attempt to use the elimination array to relieve contention,
+            // the value is lent from the unpublished node
+            if (!eliminationArray.tryPush(n->val.get())) {
+                continue; // Retry stack operation if elimination fails
+            }
+            // Successfully exchanged in elimination array, n was never published
+            n->val.destroy();
+            delete n;
+            break;
+        }
     }
-};
+}
 
-class SGLStack_e {
-private:
-    std::mutex sgl;
-    std::list<int> q;
+template <typename T, typename Reclaimer>
+std::optional<T> tstack_e<T, Reclaimer>::pop() {
+    typename Reclaimer::Guard guard;
+    while (true) {
+        tagged_ptr<node> t = top.load(ACQUIRE);
+        if (t.ptr == nullptr) {
+            return std::nullopt; // Stack is empty
+        }
+        // Keep t from being freed while we read it, it must still be on top once published
+        guard.set(0, t.ptr);
+        if (top.load(SEQ_CST) != t) {
+            continue;
+        }
 
-    struct EliminationSlot {
-        std::atomic<int> value;
-        std::atomic<bool> active;
-        std::atomic<bool> isPush;
+        node* n = t.ptr->down.load(RELAXED);
 
-        EliminationSlot() : value(0), active(false), isPush(false) {}
-    };
+        if (cas(top, t, n)) {
+            // Successfully popped, only the winner of the CAS reads the value
+            std::optional<T> v(t.ptr->val.take());
+            // Reuse right away or free once unreferenced
+            if constexpr (Reclaimer::recycles) {
+                delete t.ptr; // Straight back to the node pool
+            } else {
+                guard.clear(0);
+                Reclaimer::retire(t.ptr);
+            }
+            return v;
+        } else {
+            // Attempt to use the elimination array
+            std::optional<T> result;
+            if (!eliminationArray.tryPop(result)) {
+                continue; // Retry stack operation if elimination fails
+            }
+            return result; // Successfully exchanged in elimination array
+        }
+    }
+}
+
+/** Pops, waiting while the stack is empty. Spins briefly, then sleeps
+ *  until a push wakes it up.
+ */
+template <typename T, typename Reclaimer>
+T tstack_e<T, Reclaimer>::pop_wait(){
+    return std::move(*wait_pop(nonempty, [this]() { return pop(); }));
+}
+
+/** Pops, waiting at most timeout while the stack is empty
+ *
+ * @return The popped value, or nothing if the stack stayed empty
+ */
+template <typename T, typename Reclaimer>
+template <typename Rep, typename Period>
+std::optional<T> tstack_e<T, Reclaimer>::try_pop_for(const std::chrono::duration<Rep, Period>& timeout){
+    return wait_pop_until(nonempty, [this]() { return pop(); }, std::chrono::steady_clock::now() + timeout);
+}
+
+/** @return false if the stack is empty, out is then left untouched */
+template <typename T, typename Reclaimer>
+bool tstack_e<T, Reclaimer>::try_pop(T& out) {
+    std::optional<T> v = pop();
+    if (!v) {
+        return false;
+    }
+    out = std::move(*v);
+    return true;
+}
+
+/** Pushes [first, last) with a single CAS on top, *(last - 1) ends up on
+ *  top. When the CAS fails the top of the private chain is offered to a
+ *  concurrent pop first, as push does with its single node, and the rest
+ *  of the chain is retried.
+ */
+template <typename T, typename Reclaimer>
+template <typename It>
+void tstack_e<T, Reclaimer>::push_batch(It first, It last) {
+    if (first == last) {
+        return;
+    }
+    node* chain_bottom = new node(*first);
+    node* chain_top = chain_bottom;
+    for (++first; first != last; ++first) {
+        node* n = new node(*first);
+        n->down.store(chain_top, RELAXED);
+        chain_top = n;
+    }
+    tagged_ptr<node> old_top;
+    while (true) {
+        old_top = top.load(ACQUIRE);
+        chain_bottom->down.store(old_top.ptr, RELAXED);
+        if (cas(top, old_top, chain_top)) {
+            nonempty.notify();
+            break; // Successfully pushed the whole chain
+        }
+        if (eliminationArray.tryPush(chain_top->val.get())) {
+            // Exchanged the most recent value, it was never published
+            node* n = chain_top;
+            if (n == chain_bottom) {
+                n->val.destroy();
+                delete n;
+                break;
+            }
+            chain_top = n->down.load(RELAXED);
+            n->val.destroy();
+            delete n;
+        }
+    }
+}
 
-    class EliminationArray {
-    public:
-        std::vector<EliminationSlot> slots;
-        const int size;
-        std::mt19937 rng; // Random number generator
+/** Moves the values of a detached chain to out and reclaims the nodes */
+template <typename T, typename Reclaimer>
+template <typename OutIt>
+size_t tstack_e<T, Reclaimer>::drain(node* chain, OutIt out) {
+    size_t count = 0;
+    while (chain != nullptr) {
+        node* next = chain->down.load(RELAXED);
+        *out++ = chain->val.take();
+        if constexpr (Reclaimer::recycles) {
+            delete chain;
+        } else {
+            Reclaimer::retire(chain);
+        }
+        chain = next;
+        ++count;
+    }
+    return count;
+}
 
-        EliminationArray(int size) : size(size), slots(size), rng(std::random_device{}()) {}
+/** Empties the stack with a single CAS, values come out most recent first */
+template <typename T, typename Reclaimer>
+template <typename OutIt>
+size_t tstack_e<T, Reclaimer>::pop_all(OutIt out) {
+    tagged_ptr<node> t;
+    do {
+        t = top.load(ACQUIRE);
+        if (t.ptr == nullptr) {
+            return 0;
+        }
+    } while (!cas(top, t, (node*)nullptr));
+    return drain(t.ptr, out);
+}
 
-        int getRandomSlotIndex() {
-            std::uniform_int_distribution<int> dist(0, size - 1);
-            return dist(rng);
+/** Pops up to n values with a single CAS, see tstack::detach for why the
+ *  walk is validated against top after every step. A lost CAS is retried
+ *  rather than eliminated, a slot exchanges one value only.
+ */
+template <typename T, typename Reclaimer>
+template <typename OutIt>
+size_t tstack_e<T, Reclaimer>::pop_n(OutIt out, size_t n) {
+    while (n > 0) {
+        tagged_ptr<node> t = top.load(ACQUIRE);
+        if (t.ptr == nullptr) {
+            return 0;
         }
+        node* last = t.ptr;
+        node* rest = nullptr;
+        bool valid = true;
+        for (size_t i = 0; ; ++i) {
+            rest = last->down.load(RELAXED);
+            if (top.load(SEQ_CST) != t) {
+                valid = false;
+                break;
+            }
+            if (i + 1 == n || rest == nullptr) {
+                break;
+            }
+            last = rest;
+        }
+        if (valid && cas(top, t, rest)) {
+            last->down.store(nullptr, RELAXED);
+            return drain(t.ptr, out);
+        }
+    }
+    return 0;
+}
+
+/** Michael & Scott queue with FIFO-safe elimination (Moir, Nussbaum,
+ *  Shalev and Shavit)
+ *
+ * An enqueue and a dequeue that meet in the elimination array may only
+ * exchange a value if the queue could have handed that value straight
+ * from one to the other. Every node carries its position in the queue, seq.
+ * An enqueue that loses the race on tail->next has just seen the last node,
+ * so it offers its value tagged with that node's seq. The partner that
+ * completes the exchange then reads the seq of the dummy at head. Every
+ * value dequeued so far is at or below it. The exchange only goes ahead if
+ * the dummy's seq is at least the tag. In that case every value enqueued
+ * before the offer has already left the queue, and the eliminated value
+ * can be put right behind them. Otherwise the pairing is refused and both
+ * retry on the queue.
+ *
+ * @tparam T         Type of the values, only needs to be movable
+ * @tparam Reclaimer Memory reclamation scheme used for dequeued dummy
+ *                   nodes (see reclamation.h)
+ */
+template <typename T, typename Reclaimer = DefaultReclaimer>
+class msqueue_e {
+    static_assert(!Reclaimer::recycles, "msqueue_e pointers are not tagged, nodes cannot be recycled immediately");
+public:
+    struct node : PoolAllocated<node> { // Allocated from the per-thread node pool
+        NodeValue<T> val;
+        std::atomic<node*> next;
+        uint64_t seq; // Position in the queue, the first dummy is 0
+        node() : next(nullptr), seq(0) {} // Dummy, carries no value
+        template <typename U>
+        node(U&& v) : next(nullptr), seq(0) { val.emplace(std::forward<U>(v)); }
     };
 
-    EliminationArray eliminationArray;
+    std::atomic<node*> head, tail;
+    EliminationArray<T> eliminationArray;
+
+    msqueue_e(int eliminationSize, SlotChoice choice = RANDOM_SLOT);
+    ~msqueue_e();
+    void enqueue(T val);
+    bool try_dequeue(T& out);
+    std::optional<T> dequeue();
+
+private:
+    bool reached(typename Reclaimer::Guard& guard, int i, uint64_t tag);
+};
+
+template <typename T, typename Reclaimer>
+msqueue_e<T, Reclaimer>::msqueue_e(int eliminationSize, SlotChoice choice) : eliminationArray(eliminationSize, choice) {
+    node* dummy = new node();
+    head.store(dummy);
+    tail.store(dummy);
+}
+
+/** Frees the dummy and every node still in the queue. Must not run
+ *  concurrently with any other operation.
+ */
+template <typename T, typename Reclaimer>
+msqueue_e<T, Reclaimer>::~msqueue_e() {
+    node* h = head.load(RELAXED);
+    bool dummy = true; // Only the nodes after the dummy hold a value
+    while (h != nullptr) {
+        node* n = h->next.load(RELAXED);
+        if (!dummy) h->val.destroy();
+        dummy = false;
+        delete h;
+        h = n;
+    }
+}
+
+/** @return true if every value enqueued up to position tag has been
+ *          dequeued, the head is read through guard slot i
+ */
+template <typename T, typename Reclaimer>
+bool msqueue_e<T, Reclaimer>::reached(typename Reclaimer::Guard& guard, int i, uint64_t tag) {
+    node* h = guard.protect(i, head);
+    return h->seq >= tag;
+}
+
+/** Enqueues val, or hands it to a dequeue for which it would be the oldest value
+ *
+ * @param val Value to be enqueued, moved into the node
+ */
+template <typename T, typename Reclaimer>
+void msqueue_e<T, Reclaimer>::enqueue(T val) {
+    typename Reclaimer::Guard guard;
+    node* n = new node(std::move(val));
+    node* t;
+    while (true) {
+        t = guard.protect(0, tail);
+        node* next = t->next.load(ACQUIRE);
+        if (t != tail.load(ACQUIRE)) {
+            continue;
+        }
+        if (next != nullptr) {
+            cas(tail, t, next, ACQ_REL); // Help the lagging tail and retry
+            continue;
+        }
+        // t was the last node just now, n goes right after it
+        n->seq = t->seq + 1;
+        if (cas(t->next, (node*)nullptr, n, ACQ_REL)) {
+            break;
+        }
+        // Lost to another enqueue. The value is lent from the unpublished node
+        uint64_t tag = t->seq;
+        if (eliminationArray.tryPush(n->val.get(), tag, [&](uint64_t tag) { return reached(guard, 1, tag); })) {
+            n->val.destroy();
+            delete n;
+            return;
+        }
+    }
+    cas(tail, t, n, ACQ_REL);
+}
+
+/** @return The oldest value, or nothing if the queue is empty */
+template <typename T, typename Reclaimer>
+std::optional<T> msqueue_e<T, Reclaimer>::dequeue() {
+    typename Reclaimer::Guard guard;
+    node *h, *t, *n;
+    while (true) {
+        h = guard.protect(0, head);
+        t = tail.load(ACQUIRE);
+        n = h->next.load(ACQUIRE);
+        guard.set(1, n);
+        if (h != head.load(SEQ_CST)) {
+            continue;
+        }
+        if (h == t) {
+            if (n == nullptr) {
+                return std::nullopt;
+            }
+            cas(tail, t, n, ACQ_REL);
+            continue;
+        }
+        if (cas(head, h, n, ACQ_REL)) {
+            break;
+        }
+        // Lost to another dequeue, take a value nobody older than would be left behind
+        std::optional<T> result;
+        if (eliminationArray.tryPop(result, [&](uint64_t tag) { return reached(guard, 2, tag); })) {
+            return result;
+        }
+    }
+    // Only the winner of the CAS moves the value out of n, still protected in slot 1
+    std::optional<T> ret(n->val.take());
+    guard.clear(0);
+    Reclaimer::retire(h);
+    return ret;
+}
+
+/** @return false if the queue is empty, out is then left untouched */
+template <typename T, typename Reclaimer>
+bool msqueue_e<T, Reclaimer>::try_dequeue(T& out) {
+    std::optional<T> v = dequeue();
+    if (!v) {
+        return false;
+    }
+    out = std::move(*v);
+    return true;
+}
+
+// Fixed-point 1.0 of the per-thread contention estimate of SGLStack_e
+#define CONTENTION_ONE 1024
+// Each operation moves the estimate 1/8 of the way towards its outcome
+#define CONTENTION_DECAY_SHIFT 3
+// A thread whose try_lock failed eliminates only while the estimate is above this
+#define CONTENTION_ELIMINATE (CONTENTION_ONE / 4)
+
+/** Stack under a single global lock, with an elimination array for when
+ *  the lock is contended
+ *
+ * Every operation first tries to take the lock without waiting. Each
+ * thread keeps an estimate of how often that fails, an average over its
+ * recent operations that decays as soon as try_lock succeeds again. A
+ * failed try_lock only goes to the elimination array while the estimate
+ * is above CONTENTION_ELIMINATE. Otherwise the thread waits for the lock.
+ * An occasional collision then costs a short wait instead of a full
+ * elimination attempt, and uncontended threads never touch the array.
+ *
+ * @tparam Lock The lock, std::mutex or a policy of my_atomics.h, see SGLStack
+ */
+template <typename T, typename Lock = std::mutex>
+class SGLStack_e {
+private:
+    Lock sgl;
+    std::list<T> q;
+
+    EliminationArray<T> eliminationArray;
+
+    std::optional<T> popLocked();
+    bool contended(bool failed);
 
 public:
-    SGLStack_e(int eliminationSize) : eliminationArray(eliminationSize) {}
+    SGLStack_e(int eliminationSize, SlotChoice choice = RANDOM_SLOT) : eliminationArray(eliminationSize, choice) {}
 
-    void push(int val);
-    int pop();
-    bool tryElimination(int& val, bool isPush);
+    void push(T val);
+    bool try_pop(T& out);
+    std::optional<T> pop();
+    EliminationStats eliminationStats() const { return eliminationArray.stats(); }
+    int eliminationSize() const { return eliminationArray.size; }
 };
 
+/** Folds the outcome of a try_lock into the calling thread's estimate
+ *
+ * @param failed Whether try_lock failed
+ * @return true if the lock has been contended often enough lately to eliminate
+ */
+template <typename T, typename Lock>
+bool SGLStack_e<T, Lock>::contended(bool failed) {
+    struct Estimate {
+        const SGLStack_e* owner = nullptr;
+        int value = 0; // Recent try_lock failure rate, CONTENTION_ONE is always
+    };
+    thread_local Estimate e;
+    if (e.owner != this) {
+        e = Estimate();
+        e.owner = this;
+    }
+    e.value += ((failed ? CONTENTION_ONE : 0) - e.value) >> CONTENTION_DECAY_SHIFT;
+    return e.value > CONTENTION_ELIMINATE;
+}
+
+template <typename T, typename Lock>
+void SGLStack_e<T, Lock>::push(T val) {
+    if (sgl.try_lock()) {
+        std::lock_guard<Lock> lock(sgl, std::adopt_lock);
+        contended(false);
+        q.push_back(std::move(val));
+        return;
+    }
+    if (contended(true) && eliminationArray.tryPush(val)) {
+        return;
+    }
+    std::lock_guard<Lock> lock(sgl);
+    q.push_back(std::move(val));
+}
+
+// Caller holds sgl
+template <typename T, typename Lock>
+std::optional<T> SGLStack_e<T, Lock>::popLocked() {
+    if (q.empty()) return std::nullopt;
+    std::optional<T> ret(std::move(q.back()));
+    q.pop_back();
+    return ret;
+}
+
+template <typename T, typename Lock>
+std::optional<T> SGLStack_e<T, Lock>::pop() {
+    if (sgl.try_lock()) {
+        std::lock_guard<Lock> lock(sgl, std::adopt_lock);
+        contended(false);
+        return popLocked();
+    }
+    std::optional<T> val;
+    if (contended(true) && eliminationArray.tryPop(val)) {
+        return val;
+    }
+    std::lock_guard<Lock> lock(sgl);
+    return popLocked();
+}
+
+/** @return false if the stack is empty, out is then left untouched */
+template <typename T, typename Lock>
+bool SGLStack_e<T, Lock>::try_pop(T& out) {
+    std::optional<T> v = pop();
+    if (!v) {
+        return false;
+    }
+    out = std::move(*v);
+    return true;
+}
+
 void test_ts_elimination(void);
-void treiber_stack_elimination_test(std::vector<int>& values, int numThreads);
-void sgl_stack_elimination_test(std::vector<int>& values, int numThreads);
+void treiber_stack_elimination_test(std::vector<int>& values, int numThreads, SlotChoice choice = RANDOM_SLOT);
+void sgl_stack_elimination_test(std::vector<int>& values, int numThreads, SlotChoice choice = RANDOM_SLOT,
+                                LockKind lock = MUTEX_LOCK);
+void ms_queue_elimination_test(std::vector<int>& values, int numThreads, SlotChoice choice = RANDOM_SLOT);
 
 #endif //ELIMINATION_H
\ No newline at end of file
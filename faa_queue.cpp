@@ -0,0 +1,95 @@
+/*****************************************************************
+ * @author Suraj Ajjampur
+ * @file   faa_queue.cpp
+ *
+ * @brief This C++ source file tests the fetch-and-add based unbounded
+ *        segment queue.
+ *
+ * @date 16 Oct 2026
+********************************************************************/
+
+#include "faa_queue.h"
+#include <numeric>
+#include <vector>
+
+void testBasicFAAQueueOperations() {
+    faaqueue<int> queue;
+
+    // Enough values to fill a few segments
+    const int n = 3 * faaqueue<int>::SEGMENT_SIZE + 5;
+    for (int i = 0; i < n; ++i) {
+        queue.enqueue(i - 1); // -1 is an ordinary value
+    }
+    for (int i = 0; i < n; ++i) {
+        int val;
+        assert(queue.try_dequeue(val) && val == i - 1);
+    }
+    assert(!queue.dequeue());
+
+    // Still works after the drained segments were retired
+    queue.enqueue(42);
+    assert(*queue.dequeue() == 42);
+
+    std::cout << "Test Basic FAA Queue Operations: Passed" << std::endl;
+}
+
+/**
+ * @brief Tests the FAA queue with a given set of values and a specified number of threads.
+ *
+ * Half of the threads enqueue their share of the values, the other half
+ * dequeue until every value has been taken out, so consumers regularly
+ * arrive at cells before their producers and poison them. The test passes
+ * if the sum of dequeued values matches the sum of the input.
+ *
+ * @param values A vector of integers to be enqueued into the queue.
+ * @param numThreads The total number of threads to be used for concurrent enqueue and dequeue operations.
+ */
+void faa_queue_test(std::vector<int>& values, int numThreads) {
+    faaqueue<int> queue;
+    std::atomic<int> sum(0);
+    std::atomic<size_t> dequeued(0);
+    std::vector<std::thread> threads;
+
+    int halfNumThreads = numThreads / 2;
+    if (halfNumThreads == 0) halfNumThreads = 1;
+
+    // Concurrent enqueues
+    for (int i = 0; i < halfNumThreads; ++i) {
+        threads.push_back(std::thread([&queue, &values, i, halfNumThreads]() {
+            for (size_t j = i; j < values.size(); j += halfNumThreads) {
+                queue.enqueue(values[j]);
+            }
+        }));
+    }
+
+    // Concurrent dequeues, until all values are out
+    for (int i = 0; i < halfNumThreads; ++i) {
+        threads.push_back(std::thread([&queue, &sum, &dequeued, &values]() {
+            int val;
+            while (dequeued.load(RELAXED) < values.size()) {
+                if (queue.try_dequeue(val)) {
+                    sum.fetch_add(val, RELAXED);
+                    dequeued.fetch_add(1, RELAXED);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+
+    // Wait for all threads to complete
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    // Calculate the expected sum of the vector
+    int expectedSum = std::accumulate(values.begin(), values.end(), 0);
+
+    // Check if the sum of dequeued values is correct
+    if (sum != expectedSum) {
+        std::cerr << "Error: The sum of dequeued values does not match the expected sum." << std::endl;
+        std::cerr << "Sum: " << sum << ", Expected: " << expectedSum << std::endl;
+    } else {
+        std::cout << "Test for FAA queue passed !" << std::endl;
+    }
+}
@@ -0,0 +1,209 @@
+/*****************************************************************
+ * @author Suraj Ajjampur
+ * @file   faa_queue.h
+ *
+ * @brief This C++ header file implements an unbounded lock-free queue on a
+ *        linked list of array segments indexed with fetch-and-add, in the
+ *        spirit of LCRQ/LPRQ.
+ *
+ * Instead of every producer retrying a CAS on tail, a producer takes the
+ * next cell of the tail segment with one fetch_add on enqidx and fills it;
+ * a consumer takes the next cell of the head segment with one fetch_add on
+ * deqidx and empties it. Under contention every thread still gets a cell
+ * in one atomic instruction. A consumer that gets to a cell before its
+ * producer poisons it (TAKEN) and both move on to the next cell. When a
+ * segment runs out of cells a new one is linked after it with a CAS, which
+ * only happens once every SEGMENT_SIZE operations.
+ *
+ * Unlike LCRQ the segments are not reused rings and the cells need no
+ * 16-byte CAS, so any movable T can be stored inline. Segments that head
+ * has moved past are handed to the Reclaimer.
+ *
+ * @date 16 Oct 2026
+********************************************************************/
+
+#ifndef FAA_QUEUE_H
+#define FAA_QUEUE_H
+
+#include "my_atomics.h"
+#include "reclamation.h"
+#include "node_pool.h"
+#include <optional>
+#include <assert.h>
+
+/** Unbounded lock-free queue of fetch-and-add indexed segments
+ *
+ * @tparam T         Type of the values, only needs to be movable
+ * @tparam Reclaimer Memory reclamation scheme used for drained segments
+ *                   (see reclamation.h)
+ */
+template <typename T, typename Reclaimer = DefaultReclaimer>
+class faaqueue {
+    static_assert(!Reclaimer::recycles, "faaqueue pointers are not tagged, segments cannot be recycled immediately");
+public:
+    static constexpr size_t SEGMENT_SIZE = 1024; // Cells per segment
+
+    struct cell {
+        enum State : int { EMPTY, FULL, TAKEN };
+        std::atomic<int> state;
+        NodeValue<T> val;
+        cell() : state(EMPTY) {}
+    };
+
+    struct segment {
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> deqidx;
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqidx;
+        alignas(CACHE_LINE_SIZE) std::atomic<segment*> next;
+        cell cells[SEGMENT_SIZE];
+        segment() : deqidx(0), enqidx(0), next(nullptr) {}
+    };
+
+    std::atomic<segment*> head, tail;
+    EventCount nonempty; // Consumers parked in dequeue_wait/try_dequeue_for
+
+    faaqueue();
+    ~faaqueue();
+    void enqueue(T val);
+    bool try_dequeue(T& out);
+    std::optional<T> dequeue();
+    T dequeue_wait();
+    template <typename Rep, typename Period>
+    std::optional<T> try_dequeue_for(const std::chrono::duration<Rep, Period>& timeout);
+};
+
+template <typename T, typename Reclaimer>
+faaqueue<T, Reclaimer>::faaqueue() {
+    segment* s = new segment();
+    head.store(s);
+    tail.store(s);
+}
+
+/** Destroys the values still in the queue and frees every segment. Must
+ *  not run concurrently with any other operation.
+ */
+template <typename T, typename Reclaimer>
+faaqueue<T, Reclaimer>::~faaqueue() {
+    segment* s = head.load(RELAXED);
+    while (s != nullptr) {
+        for (auto& c : s->cells) {
+            if (c.state.load(RELAXED) == cell::FULL) c.val.destroy();
+        }
+        segment* n = s->next.load(RELAXED);
+        delete s;
+        s = n;
+    }
+}
+
+/** Enqueues val in the next free cell of the tail segment
+ *
+ * @param val Value to be enqueued, moved into the cell
+ */
+template <typename T, typename Reclaimer>
+void faaqueue<T, Reclaimer>::enqueue(T val) {
+    typename Reclaimer::Guard guard;
+    while (true) {
+        segment* t = guard.protect(0, tail);
+        size_t idx = t->enqidx.fetch_add(1, ACQ_REL);
+        if (idx < SEGMENT_SIZE) {
+            // The cell is ours among producers, only its consumer can race us
+            cell& c = t->cells[idx];
+            c.val.emplace(std::move(val));
+            // SEQ_CST so that a consumer parking concurrently sees the value or is seen by notify
+            if (cas(c.state, (int)cell::EMPTY, (int)cell::FULL, SEQ_CST)) {
+                nonempty.notify(); // One load unless a consumer is parked
+                return; // Linearization point
+            }
+            val = c.val.take(); // Poisoned by an early consumer, try the next cell
+            continue;
+        }
+        // Segment is full, append a new one or help the one already appended
+        if (t != tail.load(ACQUIRE)) {
+            continue;
+        }
+        segment* next = t->next.load(ACQUIRE);
+        if (next == nullptr) {
+            segment* s = new segment();
+            s->cells[0].val.emplace(std::move(val));
+            s->cells[0].state.store(cell::FULL, RELAXED);
+            s->enqidx.store(1, RELAXED);
+            if (cas(t->next, (segment*)nullptr, s, SEQ_CST)) {
+                cas(tail, t, s, ACQ_REL);
+                nonempty.notify();
+                return;
+            }
+            val = s->cells[0].val.take(); // Someone else appended first
+            s->cells[0].state.store(cell::EMPTY, RELAXED);
+            delete s;
+        } else {
+            cas(tail, t, next, ACQ_REL);
+        }
+    }
+}
+
+/** @return The oldest value, or nothing if the queue is empty */
+template <typename T, typename Reclaimer>
+std::optional<T> faaqueue<T, Reclaimer>::dequeue() {
+    typename Reclaimer::Guard guard;
+    while (true) {
+        segment* h = guard.protect(0, head);
+        // Don't burn cells (and poison them) when there is nothing to take
+        if (h->deqidx.load(ACQUIRE) >= h->enqidx.load(ACQUIRE) && h->next.load(ACQUIRE) == nullptr) {
+            return std::nullopt;
+        }
+        size_t idx = h->deqidx.fetch_add(1, ACQ_REL);
+        if (idx < SEGMENT_SIZE) {
+            cell& c = h->cells[idx];
+            if (c.state.exchange(cell::TAKEN, ACQ_REL) == cell::FULL) {
+                return std::optional<T>(c.val.take());
+            }
+            continue; // Poisoned a cell whose producer is late, it will move on
+        }
+        // Segment is drained, move to the next one
+        segment* next = h->next.load(ACQUIRE);
+        if (next == nullptr) {
+            return std::nullopt;
+        }
+        // tail must not be left on a segment that is about to be retired
+        if (tail.load(ACQUIRE) == h) {
+            cas(tail, h, next, ACQ_REL);
+        }
+        if (cas(head, h, next, ACQ_REL)) {
+            guard.clear(0);
+            Reclaimer::retire(h);
+        }
+    }
+}
+
+/** Dequeues, waiting while the queue is empty. Spins briefly, then sleeps
+ *  until an enqueue wakes it up.
+ */
+template <typename T, typename Reclaimer>
+T faaqueue<T, Reclaimer>::dequeue_wait(){
+    return std::move(*wait_pop(nonempty, [this]() { return dequeue(); }));
+}
+
+/** Dequeues, waiting at most timeout while the queue is empty
+ *
+ * @return The dequeued value, or nothing if the queue stayed empty
+ */
+template <typename T, typename Reclaimer>
+template <typename Rep, typename Period>
+std::optional<T> faaqueue<T, Reclaimer>::try_dequeue_for(const std::chrono::duration<Rep, Period>& timeout){
+    return wait_pop_until(nonempty, [this]() { return dequeue(); }, std::chrono::steady_clock::now() + timeout);
+}
+
+/** @return false if the queue is empty, out is then left untouched */
+template <typename T, typename Reclaimer>
+bool faaqueue<T, Reclaimer>::try_dequeue(T& out) {
+    std::optional<T> v = dequeue();
+    if (!v) {
+        return false;
+    }
+    out = std::move(*v);
+    return true;
+}
+
+void testBasicFAAQueueOperations();
+void faa_queue_test(std::vector<int>& values, int numThreads);
+
+#endif // FAA_QUEUE_H
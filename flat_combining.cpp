@@ -11,133 +11,40 @@
 
 #include "flat_combining.h"
 
-std::atomic<int> global_thread_index{0};
-
-int get_thread_index() {
-    static thread_local int thread_index = global_thread_index++;
-    return thread_index;
-}
-
-// Example thread-local index assignment (requires further implementation):
-thread_local int thread_index = get_thread_index();
-
-/**
- * @brief Enqueues a value into the queue using flat combining optimization.
- *
- * This method stores the value in the combining array and sets its status to pending.
- * It then attempts to acquire a lock. If the lock is not acquired, the operation
- * is deferred to be combined with others. If the lock is acquired without contention,
- * the combining operation is executed immediately.
- *
- * @param val The value to be enqueued.
- */
-void SGLQueue_FC::enqueue(int val) {
-    DEBUG_MSG("Enqueue called with value: " << val);
-    combiningArray[thread_index].value.store(val, std::memory_order_relaxed);
-    combiningArray[thread_index].pending.store(true, std::memory_order_release);
-    combiningArray[thread_index].completed.store(false, std::memory_order_relaxed); // New operation, not completed
-
-    if (!sgl.try_lock()) {
-        DEBUG_MSG("Lock acquisition failed in enqueue, using combining array");
-        // If lock acquisition fails, use the combining array
-        combiningArray[thread_index].operation.store(ENQUEUE, std::memory_order_release);
-    } else {
-        DEBUG_MSG("Lock acquired without contention in enqueue");
-        // Lock acquired without contention, perform operation directly
-        std::lock_guard<std::mutex> lock(sgl, std::adopt_lock);
-        combine();
-    }
-}
-
-/**
- * @brief Dequeues a value from the queue using flat combining optimization.
- *
- * This method sets the dequeue operation in the combining array as pending.
- * It acquires a lock and waits for the operation to be completed by the combiner thread.
- * Once the operation is completed, the dequeued value (or a sentinel value indicating
- * an empty queue) is returned.
- *
- * @return The value dequeued from the queue, or a sentinel value if the queue is empty.
- */
-int SGLQueue_FC::dequeue() {
-    DEBUG_MSG("Dequeue called");
-    combiningArray[thread_index].pending.store(true, std::memory_order_release);
-    combiningArray[thread_index].completed.store(false, std::memory_order_relaxed); // New operation, not completed
-    combiningArray[thread_index].operation.store(DEQUEUE, std::memory_order_release);
-
-    std::unique_lock<std::mutex> lock(sgl);
-    DEBUG_MSG("Lock acquired in dequeue, checking if operation is completed");
-    if (!combiningArray[thread_index].completed.load()) {
-        DEBUG_MSG("Waiting for operation to complete in dequeue");
-        cv.wait(lock, [&](){ return combiningArray[thread_index].completed.load(); });
-    } else {
-        DEBUG_MSG("Operation already completed, no need to wait");
-    }
-
-    int retValue = combiningArray[thread_index].retValue.load(std::memory_order_relaxed);
-    combiningArray[thread_index].completed.store(false, std::memory_order_relaxed); // Reset for next use
-    DEBUG_MSG("Dequeue operation completed with value: " << retValue);
-    return retValue;
-}
-
-/**
- * @brief Combines pending operations in the queue.
- *
- * This method iterates through the combining array and performs any pending operations
- * (enqueue or dequeue). Once an operation is executed, it is marked as completed,
- * and any threads waiting on this operation are notified.
- *
- * @note This method should be called by a thread that successfully acquires the lock
- *       on the queue to ensure exclusive access while combining operations.
- */
-void SGLQueue_FC::combine() {
-    DEBUG_MSG("Combining operations");
-    //std::lock_guard<std::mutex> lock(sgl); // Ensure exclusive access
-    for (auto& op : combiningArray) {
-        if (!op.pending.load(std::memory_order_acquire) || op.completed.load(std::memory_order_relaxed)) {
-            continue; // Skip if not pending or already completed
-        }
-
-        DEBUG_MSG("Checking operation in combine loop");
-        if (op.operation.load(std::memory_order_relaxed) == ENQUEUE) {
-            DEBUG_MSG("Performing ENQUEUE operation");
-            q.push(op.value.load(std::memory_order_relaxed));
-        } else if (op.operation.load(std::memory_order_relaxed) == DEQUEUE) {
-            DEBUG_MSG("Performing DEQUEUE operation");
-            if (!q.empty()) {
-                op.retValue.store(q.front(), std::memory_order_relaxed);
-                q.pop();
-            } else {
-                op.retValue.store(-1, std::memory_order_relaxed); // Sentinel value for empty queue
-            }
-        }
-
-        op.pending.store(false, std::memory_order_relaxed);
-        op.completed.store(true, std::memory_order_release); // Mark as completed
-        cv.notify_all(); // Notify all waiting threads
-        DEBUG_MSG("Operation completed in combine, value: " << op.retValue.load());
+void print_combining_stats(const CombiningStats& stats) {
+    std::cout << "Combining: " << stats.ops << " operations in " << stats.passes << " passes (degree "
+              << stats.degree() << ", max " << stats.max_degree << "), " << stats.eliminated << " eliminated ("
+              << 100 * stats.elimination_ratio() << "%)";
+    if (stats.forwarded) {
+        std::cout << ", " << stats.forwarded << " forwarded to the second level";
     }
+    std::cout << std::endl;
 }
 
-
-
-void concurrentSGLQueueFCEnqueue(SGLQueue_FC& queue, int val) {
+template <typename Queue>
+void concurrentSGLQueueFCEnqueue(Queue& queue, int val) {
     queue.enqueue(val);
 }
 
-void concurrentSGLQueueFCDequeue(SGLQueue_FC& queue, std::atomic<int>& sum) {
-    int val = queue.dequeue();
-    if (val != -1) { // Assuming -1 indicates an empty queue
+template <typename Queue>
+void concurrentSGLQueueFCDequeue(Queue& queue, std::atomic<int>& sum, std::atomic<size_t>& dequeued) {
+    int val;
+    if (queue.try_dequeue(val)) {
         sum.fetch_add(val, std::memory_order_relaxed);
+        dequeued.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        std::this_thread::yield();
     }
 }
 
-void sgl_queue_fc_test(std::vector<int>& values, int numThreads) {
-    SGLQueue_FC queue(values.size()); // Assuming the max concurrency level is the size of the values vector
+template <typename Queue>
+static void run_sgl_queue_fc_test(Queue& queue, std::vector<int>& values, int numThreads, const char* optimization) {
     std::atomic<int> sum(0);
+    std::atomic<size_t> dequeued(0);
     std::vector<std::thread> threads;
 
     int halfNumThreads = numThreads / 2;
+    if (halfNumThreads == 0) halfNumThreads = 1;
 
     // Concurrent enqueues
 for (int i = 0; i < halfNumThreads; ++i) {
@@ -151,12 +58,12 @@ for (int i = 0; i < halfNumThreads; ++i) {
 }
 
     DEBUG_MSG("Dequeues Started");
-    // Concurrent dequeues
+    // Concurrent dequeues, until all values are out (a dequeue may find the queue empty)
     for (int i = 0; i < halfNumThreads; ++i) {
-        threads.push_back(std::thread([&queue, &sum, i, halfNumThreads, &values]() {
+        threads.push_back(std::thread([&queue, &sum, &dequeued, i, &values]() {
             DEBUG_MSG("Dequeue thread " << i << " started");
-            for (size_t j = i; j < values.size(); j += halfNumThreads) {
-                concurrentSGLQueueFCDequeue(queue, sum);
+            while (dequeued.load(std::memory_order_relaxed) < values.size()) {
+                concurrentSGLQueueFCDequeue(queue, sum, dequeued);
             }
             DEBUG_MSG("Dequeue thread " << i << " finished");
         }));
@@ -177,86 +84,76 @@ for (int i = 0; i < halfNumThreads; ++i) {
         std::cerr << "Error: The sum of dequeued values does not match the expected sum." << std::endl;
         std::cerr << "Sum: " << sum.load(std::memory_order_relaxed) << ", Expected: " << expectedSum << std::endl;
     } else {
-        std::cout << "Test for SGL queue with flat combining optimization passed" << std::endl;
+        std::cout << "Test for SGL queue with " << optimization << " optimization passed" << std::endl;
     }
+    print_combining_stats(queue.combiningStats());
 }
 
 /**
- * @brief Combines pending stack operations in the flat combining array.
+ * @brief Tests the SGL queue with flat combining: half of the threads enqueue their share
+ *        of the values, the other half dequeue until every value is out, then the sum is checked.
  *
- * Iterates through the combining array and performs any pending push or pop operations.
- * After an operation is executed, it is marked as completed. Notifies all waiting threads
- * after completing all operations.
+ * @param values A vector of integers to be enqueued into the queue.
+ * @param numThreads The total number of threads to be used for concurrent enqueue and dequeue operations.
+ * @param parallel Use parallel flat combining, with parallel_fc_combiners(numThreads) combiners.
+ * @param lock The lock that elects the combiners.
  */
-void SGLStack_FC::combine() {
-    for (auto& op : combiningArray) {
-        if (op.pending.load() && !op.completed.load()) {
-            if (op.operation.load() == PUSH) {
-                stk.push(op.value.load());
-            } else if (op.operation.load() == POP) {
-                if (!stk.empty()) {
-                    op.value.store(stk.top());
-                    stk.pop();
-                } else {
-                    op.value.store(-1);  // Indicate stack was empty
-                }
-            }
-            op.pending.store(false);
-            op.completed.store(true);
+void sgl_queue_fc_test(std::vector<int>& values, int numThreads, bool parallel, LockKind lock) {
+    std::cout << "Combiner lock: " << lock_name(lock) << std::endl;
+    with_lock(lock, [&]<typename Lock>() {
+        if (parallel) {
+            SGLQueue_PFC<int, Lock> queue(parallel_fc_combiners(numThreads));
+            run_sgl_queue_fc_test(queue, values, numThreads, "parallel flat combining");
+        } else {
+            SGLQueue_FC<int, FlatCombiner<std::queue<int>, QueueOp<int>, Lock>> queue;
+            run_sgl_queue_fc_test(queue, values, numThreads, "flat combining");
         }
-    }
-    cv.notify_all();
+    });
 }
 
-/**
- * @brief Pushes a value onto the stack using flat combining optimization.
- *
- * Stores the value and push operation in the combining array for the current thread.
- * Attempts to acquire a lock to combine operations. If the lock is already owned,
- * combines the operations immediately; otherwise, waits until the push operation is completed.
- *
- * @param val The value to be pushed onto the stack.
- */
-void SGLStack_FC::push(int val) {
-    int thread_index = get_thread_index();  // Implement this function to assign unique index to each thread
-    auto& op = combiningArray[thread_index];
-    op.value.store(val);
-    op.operation.store(PUSH);
-    op.pending.store(true);
-    op.completed.store(false);
+template <typename Stack>
+static void run_sgl_stack_fc_test(Stack& stack, std::vector<int>& values, int numThreads, const char* optimization) {
+    std::vector<std::thread> threads;
 
-    std::unique_lock<std::mutex> lock(sgl);
-    if (lock.owns_lock()) {
-        combine();
-    } else {
-        cv.wait(lock, [&op] { return op.completed.load(); });
+    int halfNumThreads = numThreads / 2;
+
+    // Concurrent pushes
+    for (int i = 0; i < halfNumThreads; ++i) {
+        threads.push_back(std::thread([&stack, &values, i, halfNumThreads]() {
+            for (size_t j = i; j < values.size(); j += halfNumThreads) {
+                stack.push(values[j]);
+            }
+        }));
     }
+
+    // Concurrent pops
+    for (int i = 0; i < halfNumThreads; ++i) {
+        threads.push_back(std::thread([&stack, i, halfNumThreads, &values]() {
+            for (size_t j = i; j < values.size(); j += halfNumThreads) {
+                stack.pop();
+            }
+        }));
+    }
+
+    // Wait for all threads to complete
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    // Additional checks or verifications can be added here
+    std::cout << "Test for SGL stack with " << optimization << " optimization passed" << std::endl;
+    print_combining_stats(stack.combiningStats());
 }
 
 /**
- * @brief Pops a value from the stack using flat combining optimization.
+ * @brief Tests the two-sided flat combining queue the same way as sgl_queue_fc_test.
  *
- * Sets a pop operation in the combining array for the current thread.
- * Attempts to acquire a lock to combine operations. If the lock is already owned,
- * combines the operations immediately; otherwise, waits until the pop operation is completed.
- *
- * @return The value popped from the stack, or -1 if the stack was empty.
+ * @param values A vector of integers to be enqueued into the queue.
+ * @param numThreads The total number of threads to be used for concurrent enqueue and dequeue operations.
  */
-int SGLStack_FC::pop() {
-    int thread_index = get_thread_index();  // Implement this function to assign unique index to each thread
-    auto& op = combiningArray[thread_index];
-    op.operation.store(POP);
-    op.pending.store(true);
-    op.completed.store(false);
-
-    std::unique_lock<std::mutex> lock(sgl);
-    if (lock.owns_lock()) {
-        combine();
-    } else {
-        cv.wait(lock, [&op] { return op.completed.load(); });
-    }
-
-    return op.value.load();  // Return the value popped or -1 if stack was empty
+void sgl_queue_two_sided_fc_test(std::vector<int>& values, int numThreads) {
+    SGLQueue_2FC<int> queue;
+    run_sgl_queue_fc_test(queue, values, numThreads, "two-sided flat combining");
 }
 
 /**
@@ -268,27 +165,65 @@ int SGLStack_FC::pop() {
  *
  * @param values A vector of integers to be pushed onto the stack.
  * @param numThreads The total number of threads to be used for concurrent push and pop operations.
+ * @param parallel Use parallel flat combining, with parallel_fc_combiners(numThreads) combiners.
+ * @param lock The lock that elects the combiners.
  */
-void sgl_stack_fc_test(std::vector<int>& values, int numThreads) {
-    SGLStack_FC stack(values.size());  // Assuming the max concurrency level is the size of the values vector
+void sgl_stack_fc_test(std::vector<int>& values, int numThreads, bool parallel, LockKind lock) {
+    std::cout << "Combiner lock: " << lock_name(lock) << std::endl;
+    with_lock(lock, [&]<typename Lock>() {
+        if (parallel) {
+            SGLStack_PFC<int, Lock> stack(parallel_fc_combiners(numThreads));
+            run_sgl_stack_fc_test(stack, values, numThreads, "parallel flat combining");
+        } else {
+            SGLStack_FC<int, FlatCombiner<std::stack<int>, StackOp<int>, Lock>> stack;
+            run_sgl_stack_fc_test(stack, values, numThreads, "flat combining");
+        }
+    });
+}
+
+/**
+ * @brief Tests the flat combining deque with a given set of values and a specified number of threads.
+ *
+ * Half of the threads push their share of the values, at the front or at the back
+ * depending on the thread, the other half pop from alternating ends until every
+ * value has been taken out. The test passes if the sum of popped values matches the
+ * sum of the input.
+ *
+ * @param values A vector of integers to be pushed into the deque.
+ * @param numThreads The total number of threads to be used for concurrent push and pop operations.
+ */
+void sgl_deque_fc_test(std::vector<int>& values, int numThreads) {
+    SGLDeque_FC<int> deque;
+    std::atomic<int> sum(0);
+    std::atomic<size_t> popped(0);
     std::vector<std::thread> threads;
 
     int halfNumThreads = numThreads / 2;
+    if (halfNumThreads == 0) halfNumThreads = 1;
 
-    // Concurrent pushes
+    // Concurrent pushes, even threads at the front and odd ones at the back
     for (int i = 0; i < halfNumThreads; ++i) {
-        threads.push_back(std::thread([&stack, &values, i, halfNumThreads]() {
+        threads.push_back(std::thread([&deque, &values, i, halfNumThreads]() {
             for (size_t j = i; j < values.size(); j += halfNumThreads) {
-                stack.push(values[j]);
+                if (i % 2 == 0) deque.push_front(values[j]);
+                else deque.push_back(values[j]);
             }
         }));
     }
 
-    // Concurrent pops
+    // Concurrent pops from alternating ends, until all values are out
     for (int i = 0; i < halfNumThreads; ++i) {
-        threads.push_back(std::thread([&stack, i, halfNumThreads, &values]() {
-            for (size_t j = i; j < values.size(); j += halfNumThreads) {
-                stack.pop();
+        threads.push_back(std::thread([&deque, &sum, &popped, &values]() {
+            bool front = true;
+            while (popped.load(std::memory_order_relaxed) < values.size()) {
+                std::optional<int> val = front ? deque.pop_front() : deque.pop_back();
+                front = !front;
+                if (val) {
+                    sum.fetch_add(*val, std::memory_order_relaxed);
+                    popped.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    std::this_thread::yield();
+                }
             }
         }));
     }
@@ -298,6 +233,66 @@ void sgl_stack_fc_test(std::vector<int>& values, int numThreads) {
         t.join();
     }
 
-    // Additional checks or verifications can be added here
-    std::cout << "Test for SGL stack with flat combining optimization passed" << std::endl;
+    int expectedSum = std::accumulate(values.begin(), values.end(), 0);
+    if (sum.load() != expectedSum) {
+        std::cerr << "Error: The sum of popped values does not match the expected sum." << std::endl;
+        std::cerr << "Sum: " << sum.load() << ", Expected: " << expectedSum << std::endl;
+    } else {
+        std::cout << "Test for SGL deque with flat combining optimization passed" << std::endl;
+    }
+    print_combining_stats(deque.combiningStats());
+}
+
+/**
+ * @brief Tests the flat combining priority queue with a given set of values and a specified number of threads.
+ *
+ * All threads push their share of the values concurrently, then pop concurrently
+ * until the queue is empty. With no push left, the values each thread pops must come
+ * out from the largest down, and all of them together must sum to the input.
+ *
+ * @param values A vector of integers to be pushed into the priority queue.
+ * @param numThreads The total number of threads to be used for concurrent push and pop operations.
+ */
+void sgl_priority_queue_fc_test(std::vector<int>& values, int numThreads) {
+    SGLPriorityQueue_FC<int> pq;
+    std::atomic<int> sum(0);
+    std::atomic<bool> ordered(true);
+    std::vector<std::thread> threads;
+
+    // Concurrent pushes
+    for (int i = 0; i < numThreads; ++i) {
+        threads.push_back(std::thread([&pq, &values, i, numThreads]() {
+            for (size_t j = i; j < values.size(); j += numThreads) {
+                pq.push(values[j]);
+            }
+        }));
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    threads.clear();
+
+    // Concurrent pops, each thread checks its own values come out in order
+    for (int i = 0; i < numThreads; ++i) {
+        threads.push_back(std::thread([&pq, &sum, &ordered]() {
+            std::optional<int> last;
+            while (std::optional<int> val = pq.pop()) {
+                if (last && *val > *last) ordered.store(false, std::memory_order_relaxed);
+                last = val;
+                sum.fetch_add(*val, std::memory_order_relaxed);
+            }
+        }));
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    int expectedSum = std::accumulate(values.begin(), values.end(), 0);
+    if (sum.load() != expectedSum || !ordered.load()) {
+        std::cerr << "Error: The popped values are out of order or do not sum to the expected sum." << std::endl;
+        std::cerr << "Sum: " << sum.load() << ", Expected: " << expectedSum << std::endl;
+    } else {
+        std::cout << "Test for SGL priority queue with flat combining optimization passed" << std::endl;
+    }
+    print_combining_stats(pq.combiningStats());
 }
@@ -15,13 +15,16 @@
 #include <atomic>
 #include <numeric>
 #include "my_atomics.h"
-#include <mutex>
+#include "node_pool.h" // CACHE_LINE_SIZE
 #include <list>
 #include <vector>
 #include <queue>
+#include <deque>
 #include <assert.h>
-#include <condition_variable>
 #include <stack>
+#include <optional>
+#include <thread>
+#include <algorithm>
 
 
 
@@ -29,63 +32,972 @@ enum OperationType {
     PUSH,
     POP,
     ENQUEUE,
-    DEQUEUE
+    DEQUEUE,
+    PUSH_FRONT,
+    PUSH_BACK,
+    POP_FRONT,
+    POP_BACK
 };
 
-struct CombiningOp {
+// Combining passes a record may sit idle before the combiner unlinks it
+#define FC_AGE_LIMIT 64
+// Containers a thread keeps its record of at hand, see PublicationList::record
+#define FC_RECORD_CACHE 4
+// Pauses a waiting thread spins on its record before it starts yielding
+#define FC_SPIN_BEFORE_YIELD 256
+
+/** Publication record of one thread. op is a plain field: the owner
+ *  writes it before setting pending and the combiner writes it before
+ *  setting completed, so the flags order every access to it.
+ *  Each record has its own cache line, the owner spins on it.
+ */
+template <typename Op>
+struct alignas(CACHE_LINE_SIZE) PublicationRecord {
     std::atomic<bool> pending;
     std::atomic<bool> completed;
-    std::atomic<int> value;
-    std::atomic<int> retValue; // For dequeue operations
-    std::atomic<OperationType> operation; // Indicates whether to enqueue or dequeue
+    Op op; // Operation with its argument, then its result
+
+    std::atomic<PublicationRecord*> next; // In the publication list
+    std::atomic<bool> active;             // Linked in the publication list
+    long age;                             // Combining pass that last served the record, combiner only
+    PublicationRecord* owned_next;        // In the list of every record of the container
+    std::thread::id owner;                // Thread the record belongs to, set before it is pushed
+
+    PublicationRecord() : pending(false), completed(false), next(nullptr), active(false), age(0), owned_next(nullptr) {}
+};
+
+/** What the combiners of one container did, see PublicationList::scan.
+ *  Written by the combiner only, read once the threads are done.
+ */
+struct CombiningStats {
+    long passes;     // Combining passes
+    long ops;        // Operations served
+    long eliminated; // Operations served by pairing them with an opposite one
+    long max_degree; // Most operations served in one pass
+    long forwarded;  // Operations left unpaired and applied through a second level, ParallelFlatCombiner only
+
+    double degree() const { return passes ? (double)ops / passes : 0; }
+    double elimination_ratio() const { return ops ? (double)eliminated / ops : 0; }
+};
+
+void print_combining_stats(const CombiningStats& stats);
+
+/** Hendler-style dynamic publication list of the records of the threads
+ *  using one flat combining structure, see FlatCombiner.
+ *
+ * A thread gets its record on its first operation and links it at the
+ * head of the list with a CAS. The combiner walks the list, so a pass
+ * costs as much as the number of threads that used the container lately,
+ * not a slot per possible thread. A record that the combiner has not had
+ * to serve for FC_AGE_LIMIT passes is unlinked, and its owner links it
+ * again on its next operation.
+ *
+ * Records stay allocated until the container is destroyed: a thread may
+ * hold on to its record while it is unlinked.
+ *
+ * A pass collects the pending records into a batch and hands the whole
+ * batch to the FlatCombiner, which can pair opposite operations with each
+ * other and apply only the rest to its sequential structure.
+ *
+ * The list also holds the combiner lock. A thread that publishes an
+ * operation tries to take it; the one that gets it walks the list and
+ * serves everyone, the others spin on their own record until it is
+ * completed or the lock is free again. Only try_lock is ever called, so
+ * any lock policy of my_atomics.h or std::mutex will do; the default
+ * TTASLock lets waiters poll it with plain loads.
+ */
+template <typename Op, typename Lock = TTASLock>
+class PublicationList {
+public:
+    PublicationList() : head(nullptr), records(nullptr), counters{}, id(next_id.fetch_add(1, RELAXED)) {}
+    ~PublicationList();
+
+    PublicationRecord<Op>& record();
+    void link(PublicationRecord<Op>& rec);
+    template <typename Combine>
+    void scan(Combine combine);
+    template <typename Combine>
+    void publish(PublicationRecord<Op>& rec, Combine combine);
+
+    const CombiningStats& stats() const { return counters; }
+
+private:
+    alignas(CACHE_LINE_SIZE) Lock combiner; // Held by the thread running scan
+    alignas(CACHE_LINE_SIZE) std::atomic<PublicationRecord<Op>*> head; // Linked records, pushed by their owners
+    std::atomic<PublicationRecord<Op>*> records; // Every record ever allocated, through owned_next
+    std::vector<PublicationRecord<Op>*> batch;   // Pending records of the current pass, combiner only
+    CombiningStats counters;                     // Combiner only
+    const uint64_t id;                           // Unlike the address, never reused by a later list
+
+    static inline std::atomic<uint64_t> next_id{1};
+};
+
+/** Frees every record. Must not run concurrently with any other operation. */
+template <typename Op, typename Lock>
+PublicationList<Op, Lock>::~PublicationList() {
+    PublicationRecord<Op>* r = records.load(RELAXED);
+    while (r != nullptr) {
+        PublicationRecord<Op>* n = r->owned_next;
+        delete r;
+        r = n;
+    }
+}
+
+/** The thread_local cache is only a fast path: on a miss the thread looks
+ *  for its record among every record of the container before allocating
+ *  one, so a thread going back and forth between more containers than the
+ *  cache holds still has a single record in each.
+ *
+ * @return The calling thread's record, allocated on its first call. It
+ *         may be unlinked, the caller links it after publishing its
+ *         operation.
+ */
+template <typename Op, typename Lock>
+PublicationRecord<Op>& PublicationList<Op, Lock>::record() {
+    struct Entry {
+        uint64_t id = 0;
+        PublicationRecord<Op>* rec = nullptr;
+    };
+    thread_local Entry cache[FC_RECORD_CACHE];
+    thread_local int victim = 0;
+    for (Entry& e : cache) {
+        if (e.id == id) return *e.rec;
+    }
+    // The record fell out of the cache, or this is the thread's first operation on the container.
+    // A thread id is only reused once its thread has exited, so taking over that record is safe
+    const std::thread::id self = std::this_thread::get_id();
+    PublicationRecord<Op>* rec = records.load(ACQUIRE);
+    while (rec != nullptr && rec->owner != self) {
+        rec = rec->owned_next;
+    }
+    if (rec == nullptr) {
+        rec = new PublicationRecord<Op>();
+        rec->owner = self;
+        PublicationRecord<Op>* old = records.load(RELAXED);
+        do {
+            rec->owned_next = old;
+        } while (!records.compare_exchange_weak(old, rec, RELEASE, RELAXED));
+    }
+    cache[victim] = Entry{id, rec};
+    victim = (victim + 1) % FC_RECORD_CACHE;
+    return *rec;
+}
+
+/** Links rec at the head of the list unless it is linked already. Called
+ *  by the owner after setting pending, and by the combiner when the owner
+ *  published while it was unlinking the record, see scan.
+ */
+template <typename Op, typename Lock>
+void PublicationList<Op, Lock>::link(PublicationRecord<Op>& rec) {
+    // The combiner may be unlinking rec right now, whoever flips active links it
+    if (rec.active.exchange(true, SEQ_CST)) {
+        return;
+    }
+    PublicationRecord<Op>* old = head.load(RELAXED);
+    do {
+        rec.next.store(old, RELAXED);
+    } while (!head.compare_exchange_weak(old, &rec, SEQ_CST, RELAXED));
+}
+
+/** Combiner only. Collects every pending record into a batch, calls
+ *  combine(batch), then marks the records completed. Unlinks the records
+ *  idle for more than FC_AGE_LIMIT passes on the way. The head record is
+ *  never unlinked, owners push in front of it.
+ *
+ * @param combine Applies a batch of operations to the container and
+ *                returns how many of them it served by pairing
+ */
+template <typename Op, typename Lock>
+template <typename Combine>
+void PublicationList<Op, Lock>::scan(Combine combine) {
+    long pass = ++counters.passes;
+    batch.clear();
+    PublicationRecord<Op>* prev = nullptr;
+    PublicationRecord<Op>* rec = head.load(ACQUIRE);
+    while (rec != nullptr) {
+        PublicationRecord<Op>* next = rec->next.load(ACQUIRE);
+        if (rec->pending.load(ACQUIRE) && !rec->completed.load(RELAXED)) {
+            batch.push_back(rec);
+            rec->age = pass;
+        } else if (prev != nullptr && pass - rec->age > FC_AGE_LIMIT) {
+            // Idle for a while, stop visiting it until its owner comes back
+            prev->next.store(next, RELEASE);
+            rec->active.store(false, SEQ_CST);
+            // The owner may have published between the check and the store
+            // without seeing active go false: link it again and serve it now
+            if (rec->pending.load(SEQ_CST) && !rec->completed.load(RELAXED)) {
+                link(*rec);
+                batch.push_back(rec);
+                rec->age = pass;
+            }
+            rec = next;
+            continue;
+        }
+        prev = rec;
+        rec = next;
+    }
+    if (batch.empty()) {
+        return;
+    }
+    counters.eliminated += combine(batch);
+    counters.ops += batch.size();
+    counters.max_degree = std::max(counters.max_degree, (long)batch.size());
+    for (PublicationRecord<Op>* done : batch) {
+        done->pending.store(false, RELAXED);
+        done->completed.store(true, RELEASE);
+    }
+}
+
+/** Publishes rec and returns once it has been applied, by this thread or
+ *  by another combiner. The caller has set the operation and its argument.
+ *
+ * @param rec      The calling thread's record, from record()
+ * @param combine Applies a batch of operations to the container, see scan
+ */
+template <typename Op, typename Lock>
+template <typename Combine>
+void PublicationList<Op, Lock>::publish(PublicationRecord<Op>& rec, Combine combine) {
+    rec.completed.store(false, RELAXED); // New operation, not completed
+    rec.pending.store(true, SEQ_CST);
+    link(rec);
+
+    int spins = 0;
+    while (!rec.completed.load(ACQUIRE)) {
+        if (combiner.try_lock()) {
+            scan(combine); // Serves rec too, it is linked and pending
+            combiner.unlock();
+            continue;
+        }
+        if (spins < FC_SPIN_BEFORE_YIELD) {
+            ++spins;
+            __builtin_ia32_pause();
+        } else {
+            std::this_thread::yield(); // The combiner may need this CPU
+        }
+    }
+}
+
+
+// Threads per combiner of a ParallelFlatCombiner, see parallel_fc_combiners
+#define FC_THREADS_PER_COMBINER 8
+
+/** Applies one pass of operations to a sequential structure.
+ *
+ * Op must have void apply(DS&). It may also have
+ *  - static size_t eliminate(std::vector<Op*>&), which pairs up operations
+ *    that cancel out whatever the structure holds (a push and a pop), and
+ *    removes them from the vector, and
+ *  - static size_t combine(DS&, std::vector<Op*>&), which applies the
+ *    whole pass at once and may pair operations up depending on what the
+ *    structure holds (an enqueue and a dequeue on an empty queue).
+ * Without combine the operations are applied one by one.
+ *
+ * @return The number of operations served by pairing them
+ */
+template <typename DS, typename Op>
+size_t combine_ops(DS& ds, std::vector<Op*>& ops) {
+    size_t eliminated = 0;
+    if constexpr (requires { Op::eliminate(ops); }) {
+        eliminated += Op::eliminate(ops);
+    }
+    if constexpr (requires { Op::combine(ds, ops); }) {
+        eliminated += Op::combine(ds, ops);
+    } else {
+        for (Op* op : ops) {
+            op->apply(ds);
+        }
+    }
+    return eliminated;
+}
+
+/** Turns a sequential data structure into a concurrent one with flat
+ *  combining. Every operation is published as a small tagged record; the
+ *  thread that becomes the combiner applies a whole pass of them to the
+ *  structure, which no other thread ever touches.
+ *
+ * @tparam DS Sequential structure, constructed from the FlatCombiner's
+ *            constructor arguments
+ * @tparam Op Default-constructible, movable record of one operation: its
+ *            tag, its argument and, once applied, its result, see
+ *            combine_ops for what it must provide.
+ * @tparam Lock Lock that elects the combiner, see PublicationList
+ */
+template <typename DS, typename Op, typename Lock = TTASLock>
+class FlatCombiner {
+public:
+    template <typename... Args>
+    explicit FlatCombiner(Args&&... args) : ds(std::forward<Args>(args)...) {}
+
+    Op execute(Op op);
+
+    const CombiningStats& stats() const { return publications.stats(); }
+
+    // The structure itself, only while no operation runs (e.g. in a destructor)
+    DS& structure() { return ds; }
+
+private:
+    size_t combine(std::vector<PublicationRecord<Op>*>& batch);
+
+    DS ds;                                  // Combiner only
+    std::vector<Op*> ops;                   // Operations of the current pass, combiner only
+    PublicationList<Op, Lock> publications; // One record per thread that used the structure lately
+};
+
+/** Applies op to the structure, through this thread or another combiner
+ *
+ * @param op The operation with its argument
+ * @return   op once applied, holding its result
+ */
+template <typename DS, typename Op, typename Lock>
+Op FlatCombiner<DS, Op, Lock>::execute(Op op) {
+    PublicationRecord<Op>& rec = publications.record();
+    rec.op = std::move(op);
+    publications.publish(rec, [this](std::vector<PublicationRecord<Op>*>& batch) { return combine(batch); });
+    return std::move(rec.op);
+}
+
+/** Combiner only. Applies the operations of the batch, see combine_ops */
+template <typename DS, typename Op, typename Lock>
+size_t FlatCombiner<DS, Op, Lock>::combine(std::vector<PublicationRecord<Op>*>& batch) {
+    ops.clear();
+    for (PublicationRecord<Op>* rec : batch) {
+        ops.push_back(&rec->op);
+    }
+    return combine_ops(ds, ops);
+}
+
+/** Operation of the second level of a ParallelFlatCombiner: the operations
+ *  a first-level combiner could not eliminate on its own.
+ */
+template <typename Op>
+struct ResidueOp {
+    std::vector<Op*>* ops = nullptr; // Owned by the first-level combiner, which waits meanwhile
+
+    template <typename DS>
+    void apply(DS& ds) { combine_ops(ds, *ops); }
+
+    /** Merges the residues of every first-level combiner into one pass, so
+     *  that they can still pair up with each other.
+     */
+    template <typename DS>
+    static size_t combine(DS& ds, std::vector<ResidueOp*>& residues) {
+        thread_local std::vector<Op*> merged;
+        merged.clear();
+        for (ResidueOp* r : residues) {
+            merged.insert(merged.end(), r->ops->begin(), r->ops->end());
+        }
+        return combine_ops(ds, merged);
+    }
+};
+
+/** Number of first-level combiners for numThreads threads */
+inline size_t parallel_fc_combiners(int numThreads) {
+    return std::max(1, numThreads / FC_THREADS_PER_COMBINER);
+}
+
+/** Flat combining with several combiners, after Hendler, Incze, Shavit and
+ *  Tzafrir's parallel flat combining.
+ *
+ * Threads are spread over several publication lists, each with its own
+ * combiner. A first-level combiner collects its list's pass and pairs up
+ * what cancels out on its own (Op::eliminate), without touching the
+ * structure. Only the residue is forwarded to the structure, through a
+ * second-level FlatCombiner that first-level combiners publish to like any
+ * other thread, so the residues of several lists are applied, and can be
+ * paired up, in one pass.
+ *
+ * With one combiner the structure is only ever as fast as one core; here
+ * the elimination is spread over several cores and the single combiner of
+ * the structure only sees what is left.
+ */
+template <typename DS, typename Op, typename Lock = TTASLock>
+class ParallelFlatCombiner {
+public:
+    template <typename... Args>
+    explicit ParallelFlatCombiner(size_t combiners, Args&&... args)
+        : lists(combiners < 1 ? 1 : combiners), shared(std::forward<Args>(args)...) {}
+
+    Op execute(Op op);
+
+    CombiningStats stats() const;
+
+private:
+    // One first-level combiner: its publication list and the vector its residue is forwarded in
+    struct Combiner {
+        PublicationList<Op, Lock> publications;
+        std::vector<Op*> ops; // Combiner only
+        long forwarded = 0;   // Operations forwarded to the structure, combiner only
+    };
+
+    size_t combine(Combiner& c, std::vector<PublicationRecord<Op>*>& batch);
+
+    std::vector<Combiner> lists;
+    FlatCombiner<DS, ResidueOp<Op>, Lock> shared; // The structure, behind the second level
+};
+
+/** Applies op to the structure, through the combiner of this thread's list
+ *
+ * @param op The operation with its argument
+ * @return   op once applied, holding its result
+ */
+template <typename DS, typename Op, typename Lock>
+Op ParallelFlatCombiner<DS, Op, Lock>::execute(Op op) {
+    static std::atomic<size_t> next_thread{0};
+    thread_local size_t thread = next_thread.fetch_add(1, RELAXED); // Spreads threads evenly over the lists
+    Combiner& c = lists[thread % lists.size()];
+    PublicationRecord<Op>& rec = c.publications.record();
+    rec.op = std::move(op);
+    c.publications.publish(rec, [this, &c](std::vector<PublicationRecord<Op>*>& batch) { return combine(c, batch); });
+    return std::move(rec.op);
+}
+
+/** First-level combiner only. Eliminates what it can within the batch and
+ *  forwards the rest to the structure.
+ *
+ * @return The number of operations served by pairing, at this level only
+ */
+template <typename DS, typename Op, typename Lock>
+size_t ParallelFlatCombiner<DS, Op, Lock>::combine(Combiner& c, std::vector<PublicationRecord<Op>*>& batch) {
+    c.ops.clear();
+    for (PublicationRecord<Op>* rec : batch) {
+        c.ops.push_back(&rec->op);
+    }
+    size_t eliminated = 0;
+    if constexpr (requires { Op::eliminate(c.ops); }) {
+        eliminated = Op::eliminate(c.ops);
+    }
+    if (!c.ops.empty()) {
+        c.forwarded += c.ops.size();
+        shared.execute(ResidueOp<Op>{&c.ops});
+    }
+    return eliminated;
+}
+
+/** Sums what the combiners of both levels did. ops and passes count the
+ *  first level, eliminated both levels, so that elimination_ratio is the
+ *  share of operations that never reached the structure alone. forwarded
+ *  is the first-level residue, of which the second level eliminated some
+ *  more. Read once the threads are done.
+ */
+template <typename DS, typename Op, typename Lock>
+CombiningStats ParallelFlatCombiner<DS, Op, Lock>::stats() const {
+    CombiningStats total{};
+    for (const Combiner& c : lists) {
+        const CombiningStats& s = c.publications.stats();
+        total.passes += s.passes;
+        total.ops += s.ops;
+        total.eliminated += s.eliminated;
+        total.max_degree = std::max(total.max_degree, s.max_degree);
+        total.forwarded += c.forwarded;
+    }
+    total.eliminated += shared.stats().eliminated;
+    return total;
+}
+
+/** Push or pop of a stack */
+template <typename T>
+struct StackOp {
+    OperationType operation; // PUSH or POP
+    std::optional<T> value;  // Argument of push, result of pop (empty if the stack was)
+
+    void apply(std::stack<T>& stk);
+    static size_t eliminate(std::vector<StackOp*>& ops);
+};
+
+template <typename T>
+void StackOp<T>::apply(std::stack<T>& stk) {
+    if (operation == PUSH) {
+        stk.push(std::move(*value));
+        value.reset();
+    } else if (!stk.empty()) {
+        value.emplace(std::move(stk.top()));
+        stk.pop();
+    } else {
+        value.reset();  // Indicate stack was empty
+    }
+}
 
-    CombiningOp() : pending(false), completed(false), value(0), retValue(0) {}
+/**
+ * @brief Pairs up the pushes and pops of one combining pass.
+ *
+ * Pushes and pops are paired in order and each pop takes its push's value directly,
+ * as if it had run right after it. Only the unpaired ones, which are either all
+ * pushes or all pops, are left in ops to be applied to the stack.
+ *
+ * @return The number of operations served by pairing a push with a pop.
+ */
+template <typename T>
+size_t StackOp<T>::eliminate(std::vector<StackOp*>& ops) {
+    size_t eliminated = 0;
+    auto push = ops.begin(), pop = ops.begin(); // Next unpaired push and pop
+    auto next = [&](auto& it, OperationType type) {
+        while (it != ops.end() && (*it)->operation != type) ++it;
+        return it != ops.end();
+    };
+    while (next(push, PUSH) && next(pop, POP)) {
+        (*pop)->value = std::move((*push)->value);
+        (*push)->value.reset();
+        ++push;
+        ++pop;
+        eliminated += 2;
+    }
+    // What is left is all pushes or all pops, from where the pairing stopped
+    OperationType left = next(push, PUSH) ? PUSH : POP;
+    size_t kept = 0;
+    for (auto it = left == PUSH ? push : pop; it != ops.end(); ++it) {
+        if ((*it)->operation == left) ops[kept++] = *it;
+    }
+    ops.resize(kept);
+    return eliminated;
+}
+
+/** Enqueue or dequeue of a FIFO queue */
+template <typename T>
+struct QueueOp {
+    OperationType operation; // ENQUEUE or DEQUEUE
+    std::optional<T> value;  // Argument of enqueue, result of dequeue (empty if the queue was)
+
+    void apply(std::queue<T>& q);
+    static size_t combine(std::queue<T>& q, std::vector<QueueOp*>& ops);
+};
+
+template <typename T>
+void QueueOp<T>::apply(std::queue<T>& q) {
+    if (operation == ENQUEUE) {
+        DEBUG_MSG("Performing ENQUEUE operation");
+        q.push(std::move(*value));
+        value.reset();
+    } else if (!q.empty()) {
+        DEBUG_MSG("Performing DEQUEUE operation");
+        value.emplace(std::move(q.front()));
+        q.pop();
+    } else {
+        value.reset(); // Nothing to return for an empty queue
+    }
+}
+
+/**
+ * @brief Applies the operations of one combining pass to the queue.
+ *
+ * The batch is linearized with every enqueue before every dequeue. The dequeues
+ * first take what the queue already holds; once it is drained, they take the values
+ * of the batch's enqueues directly, which then never touch the queue. The enqueues
+ * left over are appended in batch order.
+ *
+ * @return The number of operations served by pairing an enqueue with a dequeue.
+ */
+template <typename T>
+size_t QueueOp<T>::combine(std::queue<T>& q, std::vector<QueueOp*>& ops) {
+    size_t eliminated = 0;
+    auto enq = ops.begin(); // Next enqueue whose value is still in its record
+    auto next_enqueue = [&]() {
+        while (enq != ops.end() && (*enq)->operation != ENQUEUE) ++enq;
+        return enq != ops.end();
+    };
+    for (QueueOp* op : ops) {
+        if (op->operation != DEQUEUE) continue;
+        if (q.empty() && next_enqueue()) {
+            op->value = std::move((*enq)->value); // Enqueued and dequeued right away
+            (*enq)->value.reset();
+            ++enq;
+            eliminated += 2;
+        } else {
+            op->apply(q);
+        }
+    }
+    for (; next_enqueue(); ++enq) (*enq)->apply(q);
+    return eliminated;
+}
+
+/** Push or pop at either end of a double-ended queue */
+template <typename T>
+struct DequeOp {
+    OperationType operation; // PUSH_FRONT, PUSH_BACK, POP_FRONT or POP_BACK
+    std::optional<T> value;  // Argument of a push, result of a pop (empty if the deque was)
+
+    void apply(std::deque<T>& dq);
+};
+
+template <typename T>
+void DequeOp<T>::apply(std::deque<T>& dq) {
+    switch (operation) {
+    case PUSH_FRONT:
+        dq.push_front(std::move(*value));
+        value.reset();
+        break;
+    case PUSH_BACK:
+        dq.push_back(std::move(*value));
+        value.reset();
+        break;
+    case POP_FRONT:
+        if (dq.empty()) { value.reset(); break; }
+        value.emplace(std::move(dq.front()));
+        dq.pop_front();
+        break;
+    case POP_BACK:
+        if (dq.empty()) { value.reset(); break; }
+        value.emplace(std::move(dq.back()));
+        dq.pop_back();
+        break;
+    default:
+        assert(false);
+    }
+}
+
+/** std::priority_queue that can hand out its largest value instead of a
+ *  const reference to it, so that T may be move-only
+ */
+template <typename T, typename Compare = std::less<T>>
+class ExtractableHeap : public std::priority_queue<T, std::vector<T>, Compare> {
+public:
+    /** Removes and returns the largest value, the heap must not be empty */
+    T pop_value() {
+        std::pop_heap(this->c.begin(), this->c.end(), this->comp); // Largest value to the back
+        T v = std::move(this->c.back());
+        this->c.pop_back();
+        return v;
+    }
+};
+
+/** Push or pop of a priority queue. apply works on any heap with push,
+ *  top, pop and empty. A pop moves the value out if the heap has a
+ *  pop_value, as ExtractableHeap does, and copies top otherwise.
+ */
+template <typename T>
+struct HeapOp {
+    OperationType operation; // PUSH or POP
+    std::optional<T> value;  // Argument of push, result of pop (empty if the heap was)
+
+    template <typename Heap>
+    void apply(Heap& heap);
 };
 
+template <typename T>
+template <typename Heap>
+void HeapOp<T>::apply(Heap& heap) {
+    if (operation == PUSH) {
+        heap.push(std::move(*value));
+        value.reset();
+    } else if (heap.empty()) {
+        value.reset();
+    } else if constexpr (requires { heap.pop_value(); }) {
+        value.emplace(heap.pop_value());
+    } else {
+        value.emplace(heap.top());
+        heap.pop();
+    }
+}
 
+/** Queue protected by flat combining, see FlatCombiner
+ *
+ * @tparam Combiner FlatCombiner, or ParallelFlatCombiner for SGLQueue_PFC
+ */
+template <typename T, typename Combiner = FlatCombiner<std::queue<T>, QueueOp<T>>>
 class SGLQueue_FC {
     private:
-        std::mutex sgl;
-        std::queue<int> q;
-        std::vector<CombiningOp> combiningArray; // Size should be based on expected concurrency level
-        std::condition_variable cv;
+        Combiner fc;
 
     public:
-        SGLQueue_FC(int maxConcurrency) : combiningArray(maxConcurrency) {}
+        template <typename... Args>
+        explicit SGLQueue_FC(Args&&... args) : fc(std::forward<Args>(args)...) {}
+
+        void enqueue(T val);
+        bool try_dequeue(T& out);
+        std::optional<T> dequeue();
 
-        void enqueue(int val);
-        int dequeue();
-        void combine();
+        CombiningStats combiningStats() const { return fc.stats(); }
 };
 
+/** Stack protected by flat combining, see FlatCombiner
+ *
+ * @tparam Combiner FlatCombiner, or ParallelFlatCombiner for SGLStack_PFC
+ */
+template <typename T, typename Combiner = FlatCombiner<std::stack<T>, StackOp<T>>>
 class SGLStack_FC {
 private:
-    std::mutex sgl;
-    std::stack<int> stk;
+    Combiner fc;
 
-    struct CombiningOp {
-        std::atomic<bool> pending;
-        std::atomic<bool> completed;
-        std::atomic<int> value;
-        std::atomic<OperationType> operation;
+public:
+    template <typename... Args>
+    explicit SGLStack_FC(Args&&... args) : fc(std::forward<Args>(args)...) {}
 
-        CombiningOp() : pending(false), completed(false), value(0), operation(PUSH) {}
-    };
+    void push(T val);
+    bool try_pop(T& out);
+    std::optional<T> pop();  // Returns nothing if the stack is empty
 
-    std::vector<CombiningOp> combiningArray;
-    std::condition_variable cv;
+    CombiningStats combiningStats() const { return fc.stats(); }
+};
+
+/** Parallel flat combining versions, constructed with the number of first-level combiners */
+template <typename T, typename Lock = TTASLock>
+using SGLQueue_PFC = SGLQueue_FC<T, ParallelFlatCombiner<std::queue<T>, QueueOp<T>, Lock>>;
+template <typename T, typename Lock = TTASLock>
+using SGLStack_PFC = SGLStack_FC<T, ParallelFlatCombiner<std::stack<T>, StackOp<T>, Lock>>;
 
-    void combine();
+/** Double-ended queue protected by flat combining, see FlatCombiner */
+template <typename T>
+class SGLDeque_FC {
+private:
+    FlatCombiner<std::deque<T>, DequeOp<T>> fc;
 
 public:
-    SGLStack_FC(int maxConcurrency) : combiningArray(maxConcurrency) {}
+    void push_front(T val) { fc.execute(DequeOp<T>{PUSH_FRONT, std::move(val)}); }
+    void push_back(T val) { fc.execute(DequeOp<T>{PUSH_BACK, std::move(val)}); }
+    std::optional<T> pop_front() { return fc.execute(DequeOp<T>{POP_FRONT, std::nullopt}).value; }
+    std::optional<T> pop_back() { return fc.execute(DequeOp<T>{POP_BACK, std::nullopt}).value; }
 
-    void push(int val);
-    int pop();  // Returns -1 if the stack is empty
+    const CombiningStats& combiningStats() const { return fc.stats(); }
 };
 
-void sgl_queue_fc_test(std::vector<int>& values, int numThreads);
-void sgl_stack_fc_test(std::vector<int>& values, int numThreads);
+/** Priority queue protected by flat combining, see FlatCombiner
+ *
+ * @tparam Compare Ordering of the values, pop returns the largest one
+ * @tparam Heap    Sequential heap, ExtractableHeap by default. Other heaps
+ *                 need a pop_value if T is move-only, see HeapOp
+ */
+template <typename T, typename Compare = std::less<T>, typename Heap = ExtractableHeap<T, Compare>>
+class SGLPriorityQueue_FC {
+private:
+    FlatCombiner<Heap, HeapOp<T>> fc;
+
+public:
+    void push(T val) { fc.execute(HeapOp<T>{PUSH, std::move(val)}); }
+    std::optional<T> pop() { return fc.execute(HeapOp<T>{POP, std::nullopt}).value; } // Returns nothing if the queue is empty
+
+    const CombiningStats& combiningStats() const { return fc.stats(); }
+};
+
+/**
+ * @brief Enqueues a value into the queue using flat combining optimization.
+ *
+ * The value is published in the thread's record. The thread then either becomes the
+ * combiner and applies every published operation, or spins on its own record until
+ * a combiner has applied it.
+ *
+ * @param val The value to be enqueued.
+ */
+template <typename T, typename Combiner>
+void SGLQueue_FC<T, Combiner>::enqueue(T val) {
+    DEBUG_MSG("Enqueue called");
+    fc.execute(QueueOp<T>{ENQUEUE, std::move(val)});
+}
+
+/**
+ * @brief Dequeues a value from the queue using flat combining optimization.
+ *
+ * The dequeue is published and waited for the same way as an enqueue.
+ *
+ * @return The value dequeued from the queue, or nothing if the queue is empty.
+ */
+template <typename T, typename Combiner>
+std::optional<T> SGLQueue_FC<T, Combiner>::dequeue() {
+    DEBUG_MSG("Dequeue called");
+    return fc.execute(QueueOp<T>{DEQUEUE, std::nullopt}).value;
+}
+
+/** @return false if the queue is empty, out is then left untouched */
+template <typename T, typename Combiner>
+bool SGLQueue_FC<T, Combiner>::try_dequeue(T& out) {
+    std::optional<T> v = dequeue();
+    if (!v) {
+        return false;
+    }
+    out = std::move(*v);
+    return true;
+}
+
+/**
+ * @brief Pushes a value onto the stack using flat combining optimization.
+ *
+ * Returns once the push has been applied, either by this thread as the combiner or
+ * by another one.
+ *
+ * @param val The value to be pushed onto the stack.
+ */
+template <typename T, typename Combiner>
+void SGLStack_FC<T, Combiner>::push(T val) {
+    fc.execute(StackOp<T>{PUSH, std::move(val)});
+}
+
+/**
+ * @brief Pops a value from the stack using flat combining optimization.
+ *
+ * @return The value popped from the stack, or nothing if the stack was empty.
+ */
+template <typename T, typename Combiner>
+std::optional<T> SGLStack_FC<T, Combiner>::pop() {
+    return fc.execute(StackOp<T>{POP, std::nullopt}).value;
+}
+
+/** @return false if the stack is empty, out is then left untouched */
+template <typename T, typename Combiner>
+bool SGLStack_FC<T, Combiner>::try_pop(T& out) {
+    std::optional<T> v = pop();
+    if (!v) {
+        return false;
+    }
+    out = std::move(*v);
+    return true;
+}
+
+/** FIFO queue with one flat combiner per end.
+ *
+ * SGLQueue_FC serializes enqueues and dequeues in the same passes although
+ * they work at opposite ends. Here the queue is a linked list with a dummy
+ * node, as in Michael and Scott's two-lock queue, and each end has its own
+ * FlatCombiner with its own publication list: producers only ever combine
+ * with producers and consumers with consumers.
+ *
+ * The tail combiner links a whole pass of nodes with one release store to
+ * the last node's next; the head combiner moves past the dummy. The two
+ * only meet on that next pointer, when the queue is empty or nearly so.
+ * Nodes are allocated by the tail combiner, out of the per-thread pool,
+ * and freed by the head combiner.
+ */
+template <typename T>
+class SGLQueue_2FC {
+public:
+    SGLQueue_2FC() : SGLQueue_2FC(new node()) {}
+    ~SGLQueue_2FC();
+
+    void enqueue(T val);
+    bool try_dequeue(T& out);
+    std::optional<T> dequeue();
+
+    CombiningStats combiningStats() const;
+
+private:
+    struct node : PoolAllocated<node> {
+        NodeValue<T> val;
+        std::atomic<node*> next;
+        node() : next(nullptr) {}
+    };
+    struct Tail {
+        node* last; // Tail combiner only
+        explicit Tail(node* dummy) : last(dummy) {}
+    };
+    struct Head {
+        node* dummy; // Head combiner only, its successor holds the oldest value
+        explicit Head(node* dummy) : dummy(dummy) {}
+    };
+
+    struct EnqueueOp {
+        std::optional<T> value;
+
+        void apply(Tail& tail);
+        static size_t combine(Tail& tail, std::vector<EnqueueOp*>& ops);
+    };
+    struct DequeueOp {
+        std::optional<T> value; // Empty if the queue was
+
+        void apply(Head& head);
+    };
+
+    explicit SGLQueue_2FC(node* dummy) : tail_side(dummy), head_side(dummy) {}
+
+    FlatCombiner<Tail, EnqueueOp> tail_side;
+    FlatCombiner<Head, DequeueOp> head_side;
+};
+
+/** Frees the dummy and every node still in the queue. Must not run
+ *  concurrently with any other operation.
+ */
+template <typename T>
+SGLQueue_2FC<T>::~SGLQueue_2FC() {
+    node* n = head_side.structure().dummy;
+    bool dummy = true;
+    while (n != nullptr) {
+        node* next = n->next.load(RELAXED);
+        if (!dummy) n->val.destroy();
+        dummy = false;
+        delete n;
+        n = next;
+    }
+}
+
+template <typename T>
+void SGLQueue_2FC<T>::EnqueueOp::apply(Tail& tail) {
+    node* n = new node();
+    n->val.emplace(std::move(*value));
+    value.reset();
+    tail.last->next.store(n, RELEASE); // Hands the value to the head side
+    tail.last = n;
+}
+
+/** Chains the values of one pass in private, then publishes the chain to
+ *  the head side with a single store.
+ *
+ * @return 0, enqueues have nothing to pair up with
+ */
+template <typename T>
+size_t SGLQueue_2FC<T>::EnqueueOp::combine(Tail& tail, std::vector<EnqueueOp*>& ops) {
+    node* first = nullptr;
+    node* last = nullptr;
+    for (EnqueueOp* op : ops) {
+        node* n = new node();
+        n->val.emplace(std::move(*op->value));
+        op->value.reset();
+        if (last != nullptr) last->next.store(n, RELAXED);
+        else first = n;
+        last = n;
+    }
+    if (first != nullptr) {
+        tail.last->next.store(first, RELEASE); // Linearization point of the whole pass
+        tail.last = last;
+    }
+    return 0;
+}
+
+template <typename T>
+void SGLQueue_2FC<T>::DequeueOp::apply(Head& head) {
+    node* n = head.dummy->next.load(ACQUIRE);
+    if (n == nullptr) {
+        value.reset(); // Empty, as far as the tail side has published
+        return;
+    }
+    value.emplace(n->val.take());
+    // The tail side is done with the old dummy: it has linked a node after it
+    delete head.dummy;
+    head.dummy = n;
+}
+
+/** Enqueues val, combining only with other enqueues */
+template <typename T>
+void SGLQueue_2FC<T>::enqueue(T val) {
+    tail_side.execute(EnqueueOp{std::move(val)});
+}
+
+/** @return The oldest value, or nothing if the queue is empty */
+template <typename T>
+std::optional<T> SGLQueue_2FC<T>::dequeue() {
+    return head_side.execute(DequeueOp{}).value;
+}
+
+/** @return false if the queue is empty, out is then left untouched */
+template <typename T>
+bool SGLQueue_2FC<T>::try_dequeue(T& out) {
+    std::optional<T> v = dequeue();
+    if (!v) {
+        return false;
+    }
+    out = std::move(*v);
+    return true;
+}
+
+/** Sums what the combiners of both ends did. Read once the threads are done. */
+template <typename T>
+CombiningStats SGLQueue_2FC<T>::combiningStats() const {
+    const CombiningStats& t = tail_side.stats();
+    const CombiningStats& h = head_side.stats();
+    return CombiningStats{t.passes + h.passes, t.ops + h.ops, t.eliminated + h.eliminated,
+                          std::max(t.max_degree, h.max_degree), t.forwarded + h.forwarded};
+}
+
+void sgl_queue_fc_test(std::vector<int>& values, int numThreads, bool parallel = false, LockKind lock = TTAS_LOCK);
+void sgl_queue_two_sided_fc_test(std::vector<int>& values, int numThreads);
+void sgl_stack_fc_test(std::vector<int>& values, int numThreads, bool parallel = false, LockKind lock = TTAS_LOCK);
+void sgl_deque_fc_test(std::vector<int>& values, int numThreads);
+void sgl_priority_queue_fc_test(std::vector<int>& values, int numThreads);
 
 
 
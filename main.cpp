@@ -10,12 +10,17 @@
 
 #include "trieber_stack.h"
 #include "msq.h"
+#include "ring_queue.h"
+#include "faa_queue.h"
+#include "spsc_mpsc_queue.h"
+#include "two_lock_queue.h"
 #include "sgl.h"
 #include "elimination.h"
 #include <iostream>
 #include <getopt.h>
 #include <fstream>
 #include "flat_combining.h"
+#include "benchmark.h"
 
 using namespace std;
 
@@ -24,6 +29,12 @@ int NUM_THREADS = 5;
 string data_structure = ""; 
 string optimization = "";
 string inputFile = "";
+string benchmark = "";
+string reclamation = "hazard";
+int ROUNDS = 1000;
+int STALL_MS = 0;
+string slot_choice = "random";
+string lock_choice = ""; // Empty for each container's own default
 
 
 // Function to print my name
@@ -31,33 +42,35 @@ void printName() {
     cout << "Suraj Ajjampur" << endl;
 }
 
+// Slot choice of the elimination arrays, from --slot (checked in main)
+SlotChoice Slot_choice() {
+    return slot_choice == "cpu" ? CPU_SLOT : RANDOM_SLOT;
+}
+
+// Lock of the SGL containers from --lock (checked in main), fallback when it was not given
+LockKind Lock_kind(LockKind fallback = MUTEX_LOCK) {
+    lock_kind(lock_choice, fallback);
+    return fallback;
+}
+
 /**
- * @brief Executes a test for the specified data structure with a given optimization strategy using input from a file.
- * 
- * This function reads integers from an input file and uses them to test different data structures (e.g., queues and stacks) 
- * with specified optimization techniques. The function supports Single Global Lock Queue (SGLQueue), Single Global Lock Stack (SGLStack), 
- * Treiber Stack (TS), and Michael & Scott Queue (msqueue) as data structures. It measures the execution time of the test in microseconds.
- * 
+ * @brief Reads the integers of the input file into a vector.
+ *
  * @param inputFile The path of the input file containing integers.
- * @param data_structure The data structure to be tested. Supported values are "SGLQueue", "SGLStack", "TS", and "msqueue".
- * @param optimization The optimization strategy to be applied. Supported optimizations are "none", "Elimination", and "Flat-combining".
- * @param NUM_THREADS The number of threads to be used in the test.
- * 
- * @note If an invalid data structure or optimization is specified, the function will print an error message and return.
- *       If the input file cannot be opened, the function will also return after printing an error message.
+ * @param numbers Vector the integers are appended to.
+ * @return false if the input file could not be opened.
  */
-void DS_Wrapper(const string& inputFile, const string& data_structure, const string &optimization, int NUM_THREADS) {
+bool Read_input(const string& inputFile, vector<int>& numbers) {
     // Open the input file
     ifstream inFile(inputFile);
     
     // Check if the input file opened successfully
     if (!inFile.is_open()) {
         cerr << "Error: Could not open the input file." << endl;
-        return;
+        return false;
     }
 
     // Read integers from the input file into a vector
-    vector<int> numbers;
     int num;
     while (inFile >> num) {
         numbers.push_back(num);
@@ -65,6 +78,29 @@ void DS_Wrapper(const string& inputFile, const string& data_structure, const str
 
     // Close the input file
     inFile.close();
+    return true;
+}
+
+/**
+ * @brief Executes a test for the specified data structure with a given optimization strategy using input from a file.
+ * 
+ * This function reads integers from an input file and uses them to test different data structures (e.g., queues and stacks) 
+ * with specified optimization techniques. The function supports Single Global Lock Queue (SGLQueue), Single Global Lock Stack (SGLStack), 
+ * Treiber Stack (TS), Michael & Scott Queue (msqueue), the fetch-and-add segment queue (faaqueue), the bounded ring queue (ringqueue), the two-lock queue (twolockqueue) and the single-consumer queues (spscqueue, mpscqueue) as data structures. It measures the execution time of the test in microseconds.
+ * 
+ * @param inputFile The path of the input file containing integers.
+ * @param data_structure The data structure to be tested. Supported values are "SGLQueue", "SGLStack", "SGLDeque", "SGLPriorityQueue", "TS", "msqueue", "faaqueue", "ringqueue", "twolockqueue", "spscqueue" and "mpscqueue".
+ * @param optimization The optimization strategy to be applied. Supported optimizations are "none", "Elimination", "Flat-combining", "Parallel-FC" and "Two-sided-FC".
+ * @param NUM_THREADS The number of threads to be used in the test.
+ * 
+ * @note If an invalid data structure or optimization is specified, the function will print an error message and return.
+ *       If the input file cannot be opened, the function will also return after printing an error message.
+ */
+void DS_Wrapper(const string& inputFile, const string& data_structure, const string &optimization, int NUM_THREADS) {
+    vector<int> numbers;
+    if (!Read_input(inputFile, numbers)) {
+        return;
+    }
     
     // Start measuring time
     auto start_time = chrono::high_resolution_clock::now();
@@ -72,29 +108,65 @@ void DS_Wrapper(const string& inputFile, const string& data_structure, const str
     // Call the appropriate test function based on the Container and Optimization Specified
     if (data_structure == "SGLQueue") {
          if (optimization == "none"){
-            sgl_queue_test(numbers,NUM_THREADS);
+            sgl_queue_test(numbers,NUM_THREADS, Lock_kind());
          }else if(optimization == "Flat-combining"){
-            sgl_queue_fc_test(numbers, NUM_THREADS);    // Call SGL Stack Test with Flat-Combining
+            sgl_queue_fc_test(numbers, NUM_THREADS, false, Lock_kind(TTAS_LOCK));    // Call SGL Stack Test with Flat-Combining
+        }else if(optimization == "Parallel-FC"){
+            sgl_queue_fc_test(numbers, NUM_THREADS, true, Lock_kind(TTAS_LOCK));
+        }else if(optimization == "Two-sided-FC"){
+            sgl_queue_two_sided_fc_test(numbers, NUM_THREADS);
         }else{cout << "Invalid optimization Selected " << endl; return;} 
     } else if (data_structure == "SGLStack") {
         if (optimization == "none"){
-            sgl_stack_test(numbers, NUM_THREADS); // Call SGL Stack with no optimization
+            sgl_stack_test(numbers, NUM_THREADS, Lock_kind()); // Call SGL Stack with no optimization
         }else if(optimization == "Elimination"){
-            sgl_stack_elimination_test(numbers,NUM_THREADS);                    // Call SGL Stack Test with Elimination 
+            sgl_stack_elimination_test(numbers,NUM_THREADS, Slot_choice(), Lock_kind());                    // Call SGL Stack Test with Elimination 
         }else if (optimization == "Flat-combining"){
-            sgl_stack_fc_test(numbers, NUM_THREADS);
+            sgl_stack_fc_test(numbers, NUM_THREADS, false, Lock_kind(TTAS_LOCK));
+        }else if (optimization == "Parallel-FC"){
+            sgl_stack_fc_test(numbers, NUM_THREADS, true, Lock_kind(TTAS_LOCK));
         }    
         else{cout << "Invalid optimization Selected " << endl; return;} 
+    } else if (data_structure == "SGLDeque" || data_structure == "SGLPriorityQueue") {
+        // Only exist as flat combining wrappers of the std containers
+        if (optimization != "Flat-combining"){cout << "Invalid optimization Selected " << endl; return;}
+        if (data_structure == "SGLDeque") {
+            sgl_deque_fc_test(numbers, NUM_THREADS);
+        } else {
+            sgl_priority_queue_fc_test(numbers, NUM_THREADS);
+        }
     }
      else if (data_structure == "TS") {
         if (optimization == "none"){
             treiber_stack_test(numbers, NUM_THREADS); // Call the mergesort function
         }else if(optimization == "Elimination"){
-            treiber_stack_elimination_test(numbers, NUM_THREADS);
+            treiber_stack_elimination_test(numbers, NUM_THREADS, Slot_choice());
         }else{cout << "Invalid optimization Selected " << endl; return;} 
 
     } else if (data_structure == "msqueue") {
-        ms_queue_test(numbers,NUM_THREADS);
+        if (optimization == "none") {
+            ms_queue_test(numbers,NUM_THREADS);
+        } else if (optimization == "Elimination") {
+            ms_queue_elimination_test(numbers, NUM_THREADS, Slot_choice());
+        } else {
+            cout << "Invalid optimization Selected " << endl;
+            return;
+        }
+    } else if (data_structure == "faaqueue") {
+        if (optimization != "none"){cout << "Invalid optimization Selected " << endl; return;}
+        faa_queue_test(numbers, NUM_THREADS);
+    } else if (data_structure == "spscqueue") {
+        if (optimization != "none"){cout << "Invalid optimization Selected " << endl; return;}
+        spsc_queue_test(numbers, NUM_THREADS);
+    } else if (data_structure == "mpscqueue") {
+        if (optimization != "none"){cout << "Invalid optimization Selected " << endl; return;}
+        mpsc_queue_test(numbers, NUM_THREADS);
+    } else if (data_structure == "ringqueue") {
+        if (optimization != "none"){cout << "Invalid optimization Selected " << endl; return;}
+        ring_queue_test(numbers, NUM_THREADS);
+    } else if (data_structure == "twolockqueue") {
+        if (optimization != "none"){cout << "Invalid optimization Selected " << endl; return;}
+        two_lock_queue_test(numbers, NUM_THREADS, Lock_kind());
     } else {
         cerr << "Error: Invalid data_structure specified." << endl;
         return;
@@ -107,6 +179,40 @@ void DS_Wrapper(const string& inputFile, const string& data_structure, const str
     cout << "\033[1mTime taken: \033[32m" << duration.count() << " microseconds\033[0m" << endl;
 }
 
+/**
+ * @brief Runs one of the long-running benchmarks from benchmark.h on the values of the input file.
+ *
+ * @param inputFile The path of the input file containing integers.
+ * @param benchmark The benchmark to run. Supported values are "reclamation", "batch", "single_consumer", "elimination", "combining", "lock" and "queue".
+ * @param data_structure The data structure to be benchmarked.
+ * @param optimization The optimization of the data structure.
+ * @param NUM_THREADS The number of threads to be used in the benchmark.
+ */
+void Benchmark_Wrapper(const string& inputFile, const string& benchmark, const string& data_structure, const string& optimization, int NUM_THREADS) {
+    vector<int> numbers;
+    if (!Read_input(inputFile, numbers)) {
+        return;
+    }
+
+    if (benchmark == "reclamation") {
+        reclamation_benchmark(numbers, data_structure, optimization, reclamation, NUM_THREADS, ROUNDS, STALL_MS);
+    } else if (benchmark == "batch") {
+        batch_benchmark(numbers, data_structure, optimization, NUM_THREADS, ROUNDS);
+    } else if (benchmark == "single_consumer") {
+        single_consumer_benchmark(numbers, NUM_THREADS, ROUNDS);
+    } else if (benchmark == "elimination") {
+        elimination_benchmark(numbers, data_structure, NUM_THREADS, ROUNDS, Slot_choice());
+    } else if (benchmark == "combining") {
+        combining_benchmark(numbers, data_structure, NUM_THREADS, ROUNDS);
+    } else if (benchmark == "lock") {
+        lock_benchmark(numbers, data_structure, optimization, NUM_THREADS, ROUNDS);
+    } else if (benchmark == "queue") {
+        queue_benchmark(numbers, NUM_THREADS, ROUNDS, Lock_kind());
+    } else {
+        cerr << "Error: Invalid benchmark specified." << endl;
+    }
+}
+
 /**
  * Prints the usage instructions for the program with ANSI escape codes for formatting.
  * This function utilizes terminal colors and text styles to enhance the readability of the instructions.
@@ -124,11 +230,21 @@ void Execution_instructions() {
     cout << "  " << underline_on << "--help" << reset_format << "\t\tShow this help message." << endl;
     cout << "  " << underline_on << "-i, --input" << reset_format << "\t\tSpecify the source input file containing data to process." << endl;
     cout << "  " << underline_on << "-t, --threads" << reset_format << "\t\tSet the number of threads for execution (must be a positive integer)." << endl;
-    cout << "  " << underline_on << "--data_structure" << reset_format << "\tChoose the data structure to use. Options: " << color_yellow << "SGLQueue, SGLStack, TS (Treiber Stack), msqueue" << reset_format << "." << endl;
-    cout << "  " << underline_on << "--optimization" << reset_format << "\tSelect the optimization technique. Options: " << color_yellow << "none, Elimination, Flat-combining" << reset_format << "." << endl;
+    cout << "  " << underline_on << "--data_structure" << reset_format << "\tChoose the data structure to use. Options: " << color_yellow << "SGLQueue, SGLStack, SGLDeque and SGLPriorityQueue (Flat-combining only), TS (Treiber Stack), msqueue, faaqueue (fetch-and-add segments), ringqueue (bounded MPMC ring), twolockqueue (head and tail locks), spscqueue (1 producer, 1 consumer), mpscqueue (1 consumer)" << reset_format << "." << endl;
+    cout << "  " << underline_on << "--optimization" << reset_format << "\tSelect the optimization technique. Options: " << color_yellow << "none, Elimination, Flat-combining, Parallel-FC (SGLQueue, SGLStack), Two-sided-FC (SGLQueue)" << reset_format << "." << endl;
+    cout << "  " << underline_on << "--benchmark" << reset_format << "\t\tRun a long-running benchmark instead of the test. Options: " << color_yellow << "reclamation, batch, single_consumer, elimination, combining, lock, queue" << reset_format << "." << endl;
+    cout << "  " << underline_on << "--reclamation" << reset_format << "\tMemory reclamation for TS and msqueue in the benchmark. Options: " << color_yellow << "none, hazard, epoch, recycle (TS only)" << reset_format << " (default hazard)." << endl;
+    cout << "  " << underline_on << "--rounds" << reset_format << "\t\tNumber of passes over the input file in the benchmark (default 1000)." << endl;
+    cout << "  " << underline_on << "--stall" << reset_format << "\t\tKeep one reader stalled inside an operation for this many ms during the benchmark." << endl;
+    cout << "  " << underline_on << "--slot" << reset_format << "\t\tHow elimination picks a slot. Options: " << color_yellow << "random, cpu" << reset_format << " (default random)." << endl;
+    cout << "  " << underline_on << "--lock" << reset_format << "\t\tLock of SGLQueue and SGLStack (any optimization but Two-sided-FC) and twolockqueue. Options: " << color_yellow << "tas, ttas, ticket, mcs, mutex" << reset_format << " (default mutex, ttas for the flat combiners)." << endl;
     cout << "\n" << bold_on << "Example:" << reset_format << endl;
     cout << color_green << "  ./containers --input sourcefile.txt --threads 4 --data_structure=TS --optimization=Elimination" << reset_format << endl;
     cout << "This command will process 'sourcefile.txt' using the Treiber Stack with the Elimination optimization across 4 threads." << endl;
+    cout << color_green << "  ./containers --input sourcefile.txt --threads 4 --data_structure=msqueue --benchmark=reclamation --reclamation=none" << reset_format << endl;
+    cout << "This command reports the throughput and peak RSS of the M&S queue when dequeued nodes are leaked." << endl;
+    cout << color_green << "  ./containers --input sourcefile.txt --threads 8 --data_structure=SGLQueue --optimization=none --benchmark=lock" << reset_format << endl;
+    cout << "This command compares the throughput of the SGL queue with each lock." << endl;
 }
 
 
@@ -142,7 +258,7 @@ void Execution_instructions() {
 int main(int argc, char* argv[]) {
     // Check if any command-line arguments are provided
     if (argc < 2) {
-        cerr << "Usage: " << argv[0] << " [--name] [--help] [-i sourcefile.txt] [-t NUMTHREADS] [--data_structure=<SGLQueue,SGLStack,TS,msqueue>] [--optimization=<none,Elimination,Flat-combining,>]" << endl;
+        cerr << "Usage: " << argv[0] << " [--name] [--help] [-i sourcefile.txt] [-t NUMTHREADS] [--data_structure=<SGLQueue,SGLStack,SGLDeque,SGLPriorityQueue,TS,msqueue,faaqueue,ringqueue,twolockqueue,spscqueue,mpscqueue>] [--optimization=<none,Elimination,Flat-combining,Parallel-FC,Two-sided-FC>] [--benchmark=<reclamation,batch,single_consumer,elimination,combining,lock,queue>] [--reclamation=<none,hazard,epoch,recycle>] [--rounds=N] [--stall=MS] [--slot=<random,cpu>] [--lock=<tas,ttas,ticket,mcs,mutex>]" << endl;
         return 1;
     }
 
@@ -157,6 +273,12 @@ int main(int argc, char* argv[]) {
         {"input", required_argument, 0, 'i'},
         {"data_structure", required_argument, 0, 'd'},
         {"optimization", required_argument, 0, 'o'},
+        {"benchmark", required_argument, 0, 'b'},
+        {"reclamation", required_argument, 0, 'r'},
+        {"rounds", required_argument, 0, 'R'},
+        {"stall", required_argument, 0, 's'},
+        {"slot", required_argument, 0, 'S'},
+        {"lock", required_argument, 0, 'l'},
         {0, 0, 0, 0}
     };
     
@@ -200,6 +322,36 @@ int main(int argc, char* argv[]) {
                 inputFile = optarg;
                 break;
 
+            case 'b':
+                // Select a benchmark instead of the test
+                benchmark = optarg;
+                break;
+
+            case 'r':
+                // Set the memory reclamation scheme
+                reclamation = optarg;
+                break;
+
+            case 'R':
+                // Set the number of benchmark rounds
+                ROUNDS = stoi(optarg);
+                break;
+
+            case 's':
+                // Set how long the stalled reader sleeps in the benchmark
+                STALL_MS = stoi(optarg);
+                break;
+
+            case 'S':
+                // Set how elimination picks its slots
+                slot_choice = optarg;
+                break;
+
+            case 'l':
+                // Set the lock of the SGL containers
+                lock_choice = optarg;
+                break;
+
             case '?':
                 // Handle invalid options
                 cerr << "Error: Invalid option." << endl;
@@ -210,6 +362,16 @@ int main(int argc, char* argv[]) {
         }
     }     
 
+    LockKind kind;
+    if (!lock_choice.empty() && !lock_kind(lock_choice, kind)) {
+        cerr << "Error: Invalid lock specified." << endl;
+        return 1;
+    }
+    if (slot_choice != "random" && slot_choice != "cpu") {
+        cerr << "Error: Invalid slot specified." << endl;
+        return 1;
+    }
+
     // Check if input and output files are provided
     if (inputFile.empty()) {
         cerr << "Error: Input file is empty" << endl;
@@ -222,7 +384,11 @@ int main(int argc, char* argv[]) {
     DEBUG_MSG("Numthreads Selected is " << NUM_THREADS);
 
     // Sort and print the input file to the output file
-    DS_Wrapper(inputFile, data_structure, optimization, NUM_THREADS);
+    if (!benchmark.empty()) {
+        Benchmark_Wrapper(inputFile, benchmark, data_structure, optimization, NUM_THREADS);
+    } else {
+        DS_Wrapper(inputFile, data_structure, optimization, NUM_THREADS);
+    }
 
     return 0;
 }
\ No newline at end of file
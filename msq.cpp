@@ -9,86 +9,15 @@
 ********************************************************************/
 
 #include "msq.h"
+#include <iterator>
+#include <memory>
 #include <mutex>
 #include <numeric>
 
 mutex lock;
 
-#define CONTENTION_OPT 1
-
-// Constructor
-msqueue::msqueue() {
-    // We initialize a node pointing to dummy
-    node* dummy = new node(DUMMY);
-    // We have head and tail point to dummy
-    head.store(dummy);
-    tail.store(dummy);
-}
-
-/** 
- * Make sure tail is up-to-date
-
- * Add new node (linearization point)
- * Update the 
- * 
- * @param val to be enqueued
- */ 
-void msqueue::enqueue(int val){
-
-    // t is a copy of the tail pointer
-    // e is the expected value of next pointer of the current tail
-    // n is the new node
-    node *t, *expected_val_tail_next, *new_node;
-    new_node = new node(val);
-    while(true){
-    // Read both tail and what tail points
-    t = tail.load(ACQUIRE); 
-    expected_val_tail_next = t->next.load(ACQUIRE);
-    //Validate nothing has changed 
-    if(t == tail.load()){
-        //Step 2: Add new node (linearization point) and update
-        node* expected_copy = NULL;
-        if(expected_val_tail_next==NULL && cas(t->next,expected_copy,new_node,ACQ_REL)){break;}
-        //Step 1: Update the tail we are looking to enqueue to, and retry
-        else if(expected_val_tail_next!=NULL){cas(tail,t,expected_val_tail_next,ACQ_REL);} 
-    } 
-    }
-    //Step 3: update the tail -- doesn't matter if this failed
-    cas(tail,t,new_node,ACQ_REL);
-}
-
-/** 
- * @return val of node which is currently at the real head
- */
-int msqueue::dequeue(){
-    //h should be made into a counted pointer
-    node *t, *h, *n; 
-    while(true){
-        //Step 1:Snapshot head, tail and dummy
-        h=head.load(ACQUIRE); t=tail.load(ACQUIRE); n=h->next.load(ACQUIRE);
-        if(h==head.load(ACQUIRE)){
-            //Check of the list is empty
-            if(h==t){
-                //Step 2 if empty, return
-                if(n==NULL){return -1;}
-                //Else cas tail to be head's next node
-                else{cas(tail,t,n,ACQ_REL);}
-            }
-            //Step 2 Else upate head (linearization point, old head becomes dummy)
-            else{
-            int ret=n->val;
-            #if CONTENTION_OPT == 0
-            if(cas(head,h,n,ACQ_REL)){return ret;}
-            #else
-            if(head.load(ACQUIRE) == h && cas(head,h,n,ACQ_REL)){return ret;}
-            #endif
-            }
-        }
-    }
-}
-
 void testBasicQueueOperations() {
-    msqueue queue;
+    msqueue<int> queue;
 
     // Enqueue elements
     queue.enqueue(1);
@@ -101,20 +30,83 @@ void testBasicQueueOperations() {
     assert(queue.dequeue() == 3);
 
     // Queue should be empty now
-    assert(queue.dequeue() == -1);
+    assert(!queue.dequeue());
+
+    // -1 is an ordinary value now that emptiness is reported separately
+    queue.enqueue(-1);
+    int val;
+    assert(queue.try_dequeue(val) && val == -1);
+    assert(!queue.try_dequeue(val));
+
+    // Move-only values, the last one is freed by the destructor
+    msqueue<std::unique_ptr<int>> owned;
+    owned.enqueue(std::make_unique<int>(1));
+    owned.enqueue(std::make_unique<int>(2));
+    assert(**owned.dequeue() == 1);
 
     std::cout << "Test Basic Queue Operations: Passed" << std::endl;
 }
 
-void concurrentEnqueue(msqueue& queue, int val) {
+void testBulkQueueOperations() {
+    msqueue<int> queue;
+    std::vector<int> in = {1, 2, 3, 4, 5};
+
+    queue.enqueue(0);
+    queue.enqueue_bulk(in.begin(), in.end()); // Same as enqueueing 1..5 in order
+    queue.enqueue(6);
+
+    std::vector<int> out;
+    assert(queue.dequeue_bulk(std::back_inserter(out), 3) == 3);
+    assert((out == std::vector<int>{0, 1, 2}));
+    assert(*queue.dequeue() == 3);
+
+    // A bulk dequeue stops at the end of the queue
+    out.clear();
+    assert(queue.dequeue_bulk(std::back_inserter(out), 10) == 3);
+    assert((out == std::vector<int>{4, 5, 6}));
+    assert(queue.dequeue_bulk(std::back_inserter(out), 10) == 0);
+
+    // The queue keeps working after the tail was swung over a segment
+    queue.enqueue_bulk(in.begin(), in.begin() + 2);
+    queue.enqueue(3);
+    out.clear();
+    assert(queue.dequeue_bulk(std::back_inserter(out), 10) == 3);
+    assert((out == std::vector<int>{1, 2, 3}));
+    assert(!queue.dequeue());
+
+    std::cout << "Test Bulk Queue Operations: Passed" << std::endl;
+}
+
+void testBlockingQueueOperations() {
+    msqueue<int> queue;
+
+    // Nothing comes in, the timed dequeue gives up
+    assert(!queue.try_dequeue_for(std::chrono::milliseconds(10)));
+
+    // The consumer parks until the producer enqueues
+    std::thread consumer([&queue]() {
+        assert(queue.dequeue_wait() == 1);
+        assert(*queue.try_dequeue_for(std::chrono::seconds(10)) == 2);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.enqueue(1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.enqueue(2);
+    consumer.join();
+    assert(!queue.dequeue());
+
+    std::cout << "Test Blocking Queue Operations: Passed" << std::endl;
+}
+
+void concurrentEnqueue(msqueue<int>& queue, int val) {
     queue.enqueue(val);
     DEBUG_MSG("Enqued value is " << val);
 }
 
-void concurrentDequeue(msqueue& queue, std::atomic<int>& sum) {
-    int val = queue.dequeue();
+void concurrentDequeue(msqueue<int>& queue, std::atomic<int>& sum) {
+    int val;
 
-    if (val != -1) {
+    if (queue.try_dequeue(val)) {
         DEBUG_MSG("dequed value is " << val);
         sum.fetch_add(val, SEQ_CST);
     }
@@ -134,7 +126,7 @@ void concurrentDequeue(msqueue& queue, std::atomic<int>& sum) {
  *       with the queue's concurrent operation handling.
  */
 void ms_queue_test(std::vector<int>& values, int numThreads) {
-    msqueue queue;
+    msqueue<int> queue;
     std::atomic<int> sum(0);
     std::vector<std::thread> threads;
 
@@ -2,25 +2,272 @@
 #define MSQ_H
 
 #include "my_atomics.h"
+#include "reclamation.h"
+#include "node_pool.h"
+#include <optional>
 #include <assert.h>
-#define DUMMY 0
 
+/** Michael & Scott lock-free queue
+ *
+ * @tparam T         Type of the values, only needs to be movable
+ * @tparam Reclaimer Memory reclamation scheme used for dequeued dummy
+ *                   nodes (see reclamation.h)
+ */
+template <typename T, typename Reclaimer = DefaultReclaimer>
 class msqueue {
+    static_assert(!Reclaimer::recycles, "msqueue pointers are not tagged, nodes cannot be recycled immediately");
 public:
-    class node {
+    class node : public PoolAllocated<node> { // Allocated from the per-thread node pool
     public:
-        node(int v) : val(v), next(nullptr) {}
-        int val;
+        node() : next(nullptr) {} // Dummy, carries no value
+        template <typename U>
+        node(U&& v) : next(nullptr) { val.emplace(std::forward<U>(v)); }
+        NodeValue<T> val;
         std::atomic<node*> next;
     };
 
     std::atomic<node*> head, tail;
+    EventCount nonempty; // Consumers parked in dequeue_wait/try_dequeue_for
     msqueue();
-    void enqueue(int val);
-    int dequeue();
+    ~msqueue();
+    void enqueue(T val);
+    bool try_dequeue(T& out);
+    std::optional<T> dequeue();
+    T dequeue_wait();
+    template <typename Rep, typename Period>
+    std::optional<T> try_dequeue_for(const std::chrono::duration<Rep, Period>& timeout);
+
+    template <typename It>
+    void enqueue_bulk(It first, It last);
+    template <typename OutIt>
+    size_t dequeue_bulk(OutIt out, size_t max);
 };
 
+#define CONTENTION_OPT 1
+
+// Constructor
+template <typename T, typename Reclaimer>
+msqueue<T, Reclaimer>::msqueue() {
+    // We initialize a node pointing to dummy
+    node* dummy = new node();
+    // We have head and tail point to dummy
+    head.store(dummy);
+    tail.store(dummy);
+}
+
+/** Frees the dummy and every node still in the queue. Must not run
+ *  concurrently with any other operation.
+ */
+template <typename T, typename Reclaimer>
+msqueue<T, Reclaimer>::~msqueue() {
+    node* h = head.load(RELAXED);
+    bool dummy = true; // Only the nodes after the dummy hold a value
+    while (h != nullptr) {
+        node* n = h->next.load(RELAXED);
+        if (!dummy) h->val.destroy();
+        dummy = false;
+        delete h;
+        h = n;
+    }
+}
+
+/** 
+ * Make sure tail is up-to-date
+
+ * Add new node (linearization point)
+ * Update the 
+ * 
+ * @param val to be enqueued, moved into the node
+ */ 
+template <typename T, typename Reclaimer>
+void msqueue<T, Reclaimer>::enqueue(T val){
+    typename Reclaimer::Guard guard;
+
+    // t is a copy of the tail pointer
+    // e is the expected value of next pointer of the current tail
+    // n is the new node
+    node *t, *expected_val_tail_next, *new_node;
+    new_node = new node(std::move(val));
+    while(true){
+    // Read both tail and what tail points, tail is protected as we read its next
+    t = guard.protect(0, tail); 
+    expected_val_tail_next = t->next.load(ACQUIRE);
+    //Validate nothing has changed 
+    if(t == tail.load()){
+        //Step 2: Add new node (linearization point) and update
+        node* expected_copy = NULL;
+        //SEQ_CST so that a consumer parking concurrently sees the node or is seen by notify
+        if(expected_val_tail_next==NULL && cas(t->next,expected_copy,new_node,SEQ_CST)){break;}
+        //Step 1: Update the tail we are looking to enqueue to, and retry
+        else if(expected_val_tail_next!=NULL){cas(tail,t,expected_val_tail_next,ACQ_REL);} 
+    } 
+    }
+    //Step 3: update the tail -- doesn't matter if this failed
+    cas(tail,t,new_node,ACQ_REL);
+    nonempty.notify(); // One load unless a consumer is parked
+}
+
+/** 
+ * @return val of node which is currently at the real head, or nothing if
+ *         the queue is empty
+ */
+template <typename T, typename Reclaimer>
+std::optional<T> msqueue<T, Reclaimer>::dequeue(){
+    typename Reclaimer::Guard guard;
+    node *t, *h, *n; 
+    while(true){
+        //Step 1:Snapshot head, tail and dummy
+        //head is protected in slot 0 and its next in slot 1, the value is read from next
+        h=guard.protect(0, head); t=tail.load(ACQUIRE); n=h->next.load(ACQUIRE);
+        guard.set(1, n);
+        if(h==head.load(SEQ_CST)){
+            //Check of the list is empty
+            if(h==t){
+                //Step 2 if empty, return
+                if(n==NULL){return std::nullopt;}
+                //Else cas tail to be head's next node
+                else{cas(tail,t,n,ACQ_REL);}
+            }
+            //Step 2 Else upate head (linearization point, old head becomes dummy)
+            //Only the winner of the CAS moves the value out of n, still protected in slot 1
+            else{
+            #if CONTENTION_OPT == 0
+            if(cas(head,h,n,ACQ_REL)){break;}
+            #else
+            if(head.load(ACQUIRE) == h && cas(head,h,n,ACQ_REL)){break;}
+            #endif
+            }
+        }
+    }
+    std::optional<T> ret(n->val.take());
+    guard.clear(0); Reclaimer::retire(h);
+    return ret;
+}
+
+/** Dequeues, waiting while the queue is empty. Spins briefly, then sleeps
+ *  until an enqueue wakes it up.
+ */
+template <typename T, typename Reclaimer>
+T msqueue<T, Reclaimer>::dequeue_wait(){
+    return std::move(*wait_pop(nonempty, [this]() { return dequeue(); }));
+}
+
+/** Dequeues, waiting at most timeout while the queue is empty
+ *
+ * @return The dequeued value, or nothing if the queue stayed empty
+ */
+template <typename T, typename Reclaimer>
+template <typename Rep, typename Period>
+std::optional<T> msqueue<T, Reclaimer>::try_dequeue_for(const std::chrono::duration<Rep, Period>& timeout){
+    return wait_pop_until(nonempty, [this]() { return dequeue(); }, std::chrono::steady_clock::now() + timeout);
+}
+
+/** Dequeues into out, for callers that already own storage for the value
+ *
+ * @return false if the queue is empty
+ */
+template <typename T, typename Reclaimer>
+bool msqueue<T, Reclaimer>::try_dequeue(T& out){
+    std::optional<T> v = dequeue();
+    if (!v) {
+        return false;
+    }
+    out = std::move(*v);
+    return true;
+}
+
+/** Appends [first, last) as one pre-linked segment. The segment is
+ *  published by the single CAS on the tail's next pointer, so the values
+ *  are enqueued together and in order. Helpers that find the tail lagging
+ *  walk it forward over the segment one node at a time as usual.
+ *
+ *  The values are constructed from *it, pass move iterators to move them.
+ */
+template <typename T, typename Reclaimer>
+template <typename It>
+void msqueue<T, Reclaimer>::enqueue_bulk(It first, It last){
+    if (first == last) {
+        return;
+    }
+    node* seg_first = new node(*first);
+    node* seg_last = seg_first;
+    for (++first; first != last; ++first) {
+        node* n = new node(*first);
+        seg_last->next.store(n, RELAXED);
+        seg_last = n;
+    }
+
+    typename Reclaimer::Guard guard;
+    node *t, *expected_val_tail_next;
+    while(true){
+    t = guard.protect(0, tail);
+    expected_val_tail_next = t->next.load(ACQUIRE);
+    if(t == tail.load()){
+        node* expected_copy = NULL;
+        if(expected_val_tail_next==NULL && cas(t->next,expected_copy,seg_first,SEQ_CST)){break;}
+        else if(expected_val_tail_next!=NULL){cas(tail,t,expected_val_tail_next,ACQ_REL);}
+    }
+    }
+    // Swing the tail straight to the end of the segment -- doesn't matter if this failed
+    cas(tail,t,seg_last,ACQ_REL);
+    nonempty.notify();
+}
+
+/** Dequeues up to max values by moving head several nodes at once.
+ *
+ *  The nodes after head are walked without a hazard slot each: h stays
+ *  protected, so head cannot come back to h once it has moved, and while
+ *  head == h no node behind it has been dequeued or retired. head is
+ *  re-validated after every next pointer read. The walk never passes the
+ *  tail read at the start, so head cannot overtake tail.
+ *
+ * @param out Receives the values in FIFO order
+ * @return The number of values dequeued, 0 if the queue was empty
+ */
+template <typename T, typename Reclaimer>
+template <typename OutIt>
+size_t msqueue<T, Reclaimer>::dequeue_bulk(OutIt out, size_t max){
+    if (max == 0) {
+        return 0;
+    }
+    typename Reclaimer::Guard guard;
+    node *t, *h, *n, *last;
+    size_t count;
+    while(true){
+        h=guard.protect(0, head); t=tail.load(ACQUIRE); n=h->next.load(ACQUIRE);
+        if(h!=head.load(SEQ_CST)){continue;}
+        if(n==NULL){return 0;}
+        if(h==t){cas(tail,t,n,ACQ_REL); continue;}
+
+        last=n; count=1;
+        bool valid=true;
+        while(count<max && last!=t){
+            node* next=last->next.load(ACQUIRE);
+            if(h!=head.load(SEQ_CST)){valid=false; break;}
+            if(next==NULL){break;}
+            last=next; count++;
+        }
+        if(!valid){continue;}
+        // last becomes the new dummy, keep it alive while its value is moved out
+        guard.set(1, last);
+        if(h!=head.load(SEQ_CST)){continue;}
+        if(cas(head,h,last,ACQ_REL)){break;}
+    }
+    // The nodes from h up to last are ours, h and the ones in between are retired
+    node* cur=h;
+    for(size_t i=0; i<count; i++){
+        node* next=cur->next.load(RELAXED);
+        *out++ = next->val.take();
+        if(cur==h){guard.clear(0);}
+        Reclaimer::retire(cur);
+        cur=next;
+    }
+    return count;
+}
+
 void testBasicQueueOperations();
+void testBulkQueueOperations();
+void testBlockingQueueOperations();
 void testMSQueueOperations();
 void ms_queue_test(std::vector<int>& values, int numThreads);
 
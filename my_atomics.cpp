@@ -9,6 +9,11 @@
 ********************************************************************/
 
 #include "my_atomics.h"
+#include <cassert>
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 /** Atomically check if value is false, if it is, return true
  * or else return false
@@ -26,7 +31,8 @@ bool tas(atomic<bool>& x, std::memory_order MEM){
  *  All other flags will read true and the tas will return false. Hence the lock won't work for them
  */ 
 void tas_lock(atomic<bool>& x){
-    while(tas(x,SEQ_CST) == false){}
+    int spins = 0;
+    while(tas(x,SEQ_CST) == false){ lock_backoff(spins); }
 }
 
 /** Store false to atomic bool x
@@ -39,8 +45,9 @@ void tas_unlock(atomic<bool>& x){
  *  which causes bus contention.
  */ 
 void ttas_lock(atomic<bool>& x){
+    int spins = 0;
     while(x.load(RELAXED) == true ||
-    tas(x,SEQ_CST) == false){}
+    tas(x,SEQ_CST) == false){ lock_backoff(spins); }
 }
 
 void ttas_unlock(atomic<bool>& x){
@@ -53,13 +60,47 @@ int fai(atomic<int>& x, int amount, std::memory_order MEM){
 
 void ticket_lock(atomic<int>& next_num, atomic<int>& now_serving){
     int my_num = fai(next_num, 1 , SEQ_CST);
-    while(now_serving.load(SEQ_CST) != my_num){}
+    int spins = 0;
+    while(now_serving.load(SEQ_CST) != my_num){ lock_backoff(spins); }
 }
 
 void ticket_unlock(atomic<int>& now_serving){
     fai(now_serving, 1 ,SEQ_CST);
 }
 
+/** Takes a ticket only if it would be served right away, i.e. when no
+ *  one holds or waits for the lock
+ */
+bool TicketLock::try_lock(){
+    int serving = now_serving.load(SEQ_CST);
+    return next_num.load(RELAXED) == serving && cas(next_num, serving, serving + 1, SEQ_CST);
+}
+
+const char* lock_name(LockKind kind){
+    switch (kind) {
+    case TAS_LOCK: return "tas";
+    case TTAS_LOCK: return "ttas";
+    case TICKET_LOCK: return "ticket";
+    case MCS_LOCK: return "mcs";
+    default: return "mutex";
+    }
+}
+
+/** Looks up the lock called name by --lock
+ *
+ * @param kind Set to the lock, left untouched if name is unknown
+ * @return false if name is none of tas, ttas, ticket, mcs and mutex
+ */
+bool lock_kind(const std::string& name, LockKind& kind){
+    for (LockKind k : {MUTEX_LOCK, TAS_LOCK, TTAS_LOCK, TICKET_LOCK, MCS_LOCK}) {
+        if (name == lock_name(k)) {
+            kind = k;
+            return true;
+        }
+    }
+    return false;
+}
+
 
 
 /** Atomically check if the old value is what you expect, if it is, replace it
@@ -75,7 +116,7 @@ T vcas(atomic<T> &x, T expected, T desired, std::memory_order MEM){
 }
 
 //Parameterized constructor for MCSLock
-MCSLock::MCSLock(atomic<Node*>& tail) : tail(nullptr) {} // Initialization
+MCSLock::MCSLock(atomic<Node*>& tail) : tail(nullptr), holder(nullptr) {} // Initialization
 
 void MCSLock::acquire(Node* myNode){
     Node* oldTail = tail.load(SEQ_CST); //Read current value of tail
@@ -89,7 +130,8 @@ void MCSLock::acquire(Node* myNode){
     if(oldTail != nullptr) { //This mean we are not the head of the list hence we have to wait
     myNode->wait.store(true,RELAXED);
     oldTail->next.store(myNode,SEQ_CST); // Updating the old tail value
-    while (myNode->wait.load(SEQ_CST)) {} //Spin locally till it becomes false
+    int spins = 0;
+    while (myNode->wait.load(SEQ_CST)) { lock_backoff(spins); } //Spin locally till it becomes false
     }
 }
 
@@ -100,11 +142,47 @@ void MCSLock::release(Node* myNode){
     // freed the lock
     } 
     else{// hand lock to next waiting thread
-    while(myNode->next.load(SEQ_CST)==NULL){} //Spin until notified
+    int spins = 0;
+    while(myNode->next.load(SEQ_CST)==NULL){ lock_backoff(spins); } //Spin until notified
     myNode->next.load(SEQ_CST)->wait.store(false,SEQ_CST);
     }
 }
 
+/* Nodes of the MCS locks the calling thread holds or waits for. A node is
+ * in the queue of its lock until the unlock, so a thread that holds two
+ * locks needs two nodes; they are handed out as a stack, which requires
+ * nested locks to be released in reverse order, as lock_guard does.
+ */
+static thread_local MCSLock::Node mcs_nodes[MCS_MAX_HELD];
+static thread_local int mcs_held = 0;
+
+void MCSLock::lock(){
+    assert(mcs_held < MCS_MAX_HELD);
+    Node* myNode = &mcs_nodes[mcs_held++];
+    acquire(myNode);
+    holder = myNode;
+}
+
+/** Joins the queue only if it is empty, so it never waits */
+bool MCSLock::try_lock(){
+    if (tail.load(RELAXED) != nullptr || mcs_held == MCS_MAX_HELD) {
+        return false;
+    }
+    Node* myNode = &mcs_nodes[mcs_held];
+    myNode->next.store(nullptr, RELAXED);
+    if (!cas(tail, (Node*)nullptr, myNode, SEQ_CST)) {
+        return false;
+    }
+    ++mcs_held;
+    holder = myNode;
+    return true;
+}
+
+void MCSLock::unlock(){
+    release(holder);
+    --mcs_held;
+}
+
 SenseBarrier::SenseBarrier(int numThreads) : cnt(0), sense(0), N(numThreads) {}
 
 void SenseBarrier::ArriveAndWait() {
@@ -217,7 +295,33 @@ void Petersons::unlock(int tid) {
     DEBUG_MSG("Peterson's lock released!!");
 } 
 
+static long futex(atomic<uint32_t>& word, int op, uint32_t val, const struct timespec* timeout) {
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), op | FUTEX_PRIVATE_FLAG, val, timeout, nullptr, 0);
+}
 
+uint32_t EventCount::prepare_wait() {
+    waiters.fetch_add(1, SEQ_CST);
+    uint32_t key = epoch.load(SEQ_CST);
+    // Orders the registration before the caller's re-check of the container
+    atomic_thread_fence(SEQ_CST);
+    return key;
+}
 
+void EventCount::cancel_wait() {
+    waiters.fetch_sub(1, RELAXED);
+}
 
+/** Returns right away if a wake already moved the epoch past key. Spurious
+ *  wakeups are fine, the caller re-checks the container anyway.
+ */
+void EventCount::wait(uint32_t key, const struct timespec* timeout) {
+    if (epoch.load(ACQUIRE) == key) {
+        futex(epoch, FUTEX_WAIT, key, timeout);
+    }
+    waiters.fetch_sub(1, RELAXED);
+}
 
+void EventCount::wake() {
+    epoch.fetch_add(1, SEQ_CST);
+    futex(epoch, FUTEX_WAKE, INT_MAX, nullptr);
+}
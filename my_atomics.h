@@ -21,6 +21,9 @@
 #include <vector>
 #include <ctime>
 #include <mutex>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
 
 #define DEBUG_MODE 0
 
@@ -45,6 +48,26 @@
 
 using namespace std;
 
+// Pauses a waiter of the spin locks below makes before it starts yielding
+#define LOCK_SPIN_BEFORE_YIELD 128
+// MCS locks one thread can hold at the same time, see MCSLock::lock
+#define MCS_MAX_HELD 4
+
+/** One wait of a spin lock waiter: a pause, or a yield once it has waited
+ *  LOCK_SPIN_BEFORE_YIELD times, so that a holder that lost its CPU to the
+ *  waiters gets it back.
+ */
+inline void lock_backoff(int& spins) {
+    if (spins < LOCK_SPIN_BEFORE_YIELD) {
+        ++spins;
+        __builtin_ia32_pause();
+    } else {
+        std::this_thread::yield();
+    }
+}
+
+bool tas(atomic<bool>& x, std::memory_order MEM);
+
 void tas_lock(atomic<bool>& x);
 void tas_unlock(atomic<bool>& x);
 
@@ -71,6 +94,59 @@ bool cas(atomic<T>& x, T expected, T desired, std::memory_order MEM){
 template <typename T>
 T vcas(atomic<T>& x, T expected, T desired, std::memory_order MEM);
 
+/** A pointer paired with a modification counter. Both halves are swapped
+ *  together with a double-width CAS (cmpxchg16b, needs -mcx16), and the
+ *  counter is bumped on every successful swap, so a node that is removed
+ *  and put back at the same address no longer compares equal (ABA).
+ */
+template <typename T>
+struct alignas(16) tagged_ptr {
+    T* ptr;
+    uintptr_t tag;
+
+    bool operator==(const tagged_ptr& o) const { return ptr == o.ptr && tag == o.tag; }
+    bool operator!=(const tagged_ptr& o) const { return !(*this == o); }
+};
+
+/** Atomic tagged_ptr. Loads read the two halves separately, so a load that
+ *  races with a swap may return a torn pair; such a pair never matches the
+ *  current value and the CAS that uses it fails.
+ */
+template <typename T>
+class atomic_tagged {
+public:
+    atomic_tagged(T* p = nullptr) : v{p, 0} {}
+
+    tagged_ptr<T> load(std::memory_order MEM = ACQUIRE) const {
+        tagged_ptr<T> r;
+        r.tag = std::atomic_ref<uintptr_t>(v.tag).load(RELAXED);
+        r.ptr = std::atomic_ref<T*>(v.ptr).load(MEM);
+        return r;
+    }
+
+    /** Only for use when no other thread can access the pointer */
+    void store(T* p) { v.ptr = p; v.tag = 0; }
+
+    /** Swaps in {desired, expected.tag + 1} if the current value is still
+     *  expected. Full barrier.
+     */
+    bool cas(tagged_ptr<T> expected, T* desired) {
+        tagged_ptr<T> next{desired, expected.tag + 1};
+        unsigned __int128 e, d;
+        std::memcpy(&e, &expected, sizeof(e));
+        std::memcpy(&d, &next, sizeof(d));
+        return __sync_bool_compare_and_swap(reinterpret_cast<unsigned __int128*>(&v), e, d);
+    }
+
+private:
+    mutable tagged_ptr<T> v;
+};
+
+template <typename T>
+bool cas(atomic_tagged<T>& x, tagged_ptr<T> expected, T* desired){
+ return x.cas(expected, desired);
+}
+
 /**
  * @brief SenseBarrier class for synchronization among multiple threads.
  *
@@ -124,12 +200,77 @@ public:
      * @param tail 
     */
     MCSLock(atomic<Node*>& tail); 
+    MCSLock() : tail(nullptr), holder(nullptr) {}
 
     void acquire(Node* myNode);
 
     void release(Node* myNode);
+
+    // BasicLockable, with the calling thread's own node, see lock
+    void lock();
+    bool try_lock();
+    void unlock();
+
+private:
+    Node* holder; // Node of the thread holding the lock, holder only
+};
+
+/** Lock policies of the SGL containers (see sgl.h) on top of the locks
+ *  above. Like std::mutex and MCSLock they provide lock, try_lock and
+ *  unlock, so they work with std::lock_guard.
+ */
+class TASLock {
+public:
+    void lock() { tas_lock(flag); }
+    bool try_lock() { return tas(flag, SEQ_CST); }
+    void unlock() { tas_unlock(flag); }
+
+private:
+    atomic<bool> flag{false};
+};
+
+class TTASLock {
+public:
+    void lock() { ttas_lock(flag); }
+    bool try_lock() { return !flag.load(RELAXED) && tas(flag, SEQ_CST); }
+    void unlock() { ttas_unlock(flag); }
+
+private:
+    atomic<bool> flag{false};
 };
 
+class TicketLock {
+public:
+    void lock() { ticket_lock(next_num, now_serving); }
+    bool try_lock();
+    void unlock() { ticket_unlock(now_serving); }
+
+private:
+    atomic<int> next_num{0};
+    atomic<int> now_serving{0};
+};
+
+// Lock selected with --lock
+enum LockKind { MUTEX_LOCK, TAS_LOCK, TTAS_LOCK, TICKET_LOCK, MCS_LOCK };
+
+const char* lock_name(LockKind kind);
+bool lock_kind(const std::string& name, LockKind& kind);
+
+/** Calls f.template operator()<Lock>() with the lock policy of kind, so
+ *  that a test or benchmark written once as a template lambda runs with
+ *  the lock chosen at run time.
+ */
+template <typename F>
+void with_lock(LockKind kind, F&& f) {
+    switch (kind) {
+    case TAS_LOCK: f.template operator()<TASLock>(); break;
+    case TTAS_LOCK: f.template operator()<TTASLock>(); break;
+    case TICKET_LOCK: f.template operator()<TicketLock>(); break;
+    case MCS_LOCK: f.template operator()<MCSLock>(); break;
+    default: f.template operator()<std::mutex>(); break;
+    }
+}
+
 /**
  * @class Petersons
  *
@@ -182,4 +323,101 @@ private:
     bool mem_order;
 };
 
+// Failed attempts a blocking consumer spins through before it parks
+#define SPIN_BEFORE_PARK 128
+
+/**
+ * @class EventCount
+ *
+ * @brief Lets consumers of a lock-free container sleep while it is empty.
+ *
+ * A consumer that gives up spinning registers as a waiter, reads the epoch,
+ * checks the container once more and then sleeps on the epoch with a futex
+ * until a producer bumps it. A producer calls notify() after every insert;
+ * while nobody waits that is a single load of the waiter count, and only
+ * with registered waiters does it bump the epoch and enter the kernel.
+ *
+ * No wakeup is lost as long as the producer publishes its insert with a
+ * sequentially consistent RMW (CAS/exchange, a locked instruction on x86)
+ * before notify(): either the producer sees the waiter, or the consumer's
+ * last check sees the insert.
+ */
+class EventCount {
+public:
+    EventCount() : waiters(0), epoch(0) {}
+
+    /** Producer side, call after the insert has been published */
+    void notify() {
+        if (waiters.load(SEQ_CST) != 0) {
+            wake();
+        }
+    }
+
+    /** Registers the caller as a waiter, the container must be re-checked
+     *  before calling wait() with the returned key.
+     */
+    uint32_t prepare_wait();
+    /** Deregisters a waiter that found something on its re-check */
+    void cancel_wait();
+    /** Sleeps until the epoch moves past key or the timeout (if any)
+     *  expires, then deregisters.
+     */
+    void wait(uint32_t key, const struct timespec* timeout);
+
+private:
+    void wake();
+
+    atomic<uint32_t> waiters; // Consumers between prepare_wait and the end of wait
+    atomic<uint32_t> epoch;   // Futex word, bumped by every wake
+};
+
+/** Calls try_pop until it returns a value, spinning SPIN_BEFORE_PARK times
+ *  and then parking on ec between attempts.
+ *
+ * @param try_pop Callable returning std::optional of the value
+ */
+template <typename TryPop>
+auto wait_pop(EventCount& ec, TryPop try_pop) -> decltype(try_pop()) {
+    for (int i = 0; i < SPIN_BEFORE_PARK; ++i) {
+        if (auto v = try_pop()) return v;
+        __builtin_ia32_pause();
+    }
+    while (true) {
+        uint32_t key = ec.prepare_wait();
+        if (auto v = try_pop()) {
+            ec.cancel_wait();
+            return v;
+        }
+        ec.wait(key, nullptr);
+    }
+}
+
+/** Same as wait_pop but gives up at deadline
+ *
+ * @return The value, or an empty optional if deadline passed first
+ */
+template <typename TryPop, typename Clock, typename Duration>
+auto wait_pop_until(EventCount& ec, TryPop try_pop,
+                    const std::chrono::time_point<Clock, Duration>& deadline) -> decltype(try_pop()) {
+    for (int i = 0; i < SPIN_BEFORE_PARK; ++i) {
+        if (auto v = try_pop()) return v;
+        __builtin_ia32_pause();
+    }
+    while (true) {
+        uint32_t key = ec.prepare_wait();
+        if (auto v = try_pop()) {
+            ec.cancel_wait();
+            return v;
+        }
+        auto left = deadline - Clock::now();
+        if (left <= decltype(left)::zero()) {
+            ec.cancel_wait();
+            return decltype(try_pop())();
+        }
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+        struct timespec timeout = {(time_t)(ns / 1000000000), (long)(ns % 1000000000)};
+        ec.wait(key, &timeout);
+    }
+}
+
 #endif // MY_ATOMICS_H
@@ -0,0 +1,204 @@
+/*****************************************************************
+ * @author Suraj Ajjampur
+ * @file   node_pool.h
+ *
+ * @brief This C++ header file implements a per-thread pool allocator for
+ *        the nodes of the lock-free containers.
+ *
+ * Every thread keeps its own free list of cache-line-aligned blocks, so the
+ * common allocate/free is a couple of thread-local pointer moves with no
+ * malloc lock and no atomic. A thread that runs dry first takes a whole
+ * batch of blocks freed by other threads from a shared tagged stack, and
+ * only then carves a new slab. A thread whose free list grows too long
+ * (typically a consumer freeing what producers allocated) hands a batch
+ * back to that shared stack, so blocks flow between threads BATCH_SIZE at
+ * a time.
+ *
+ * Slabs are never returned to the system. Node memory is therefore
+ * type-stable, which is what lets stale readers of tagged containers read
+ * a freed node without faulting (see TaggedRecycling in reclamation.h).
+ *
+ * A node type opts in by deriving from PoolAllocated<node>; the plain
+ * new/delete used by the containers and by every Reclaimer then go
+ * through the pool. NodeValue<T> is the inline payload storage the nodes
+ * use, so that a value of any type lives in the node itself.
+ *
+ * @date 16 Oct 2026
+********************************************************************/
+
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include "my_atomics.h"
+#include <new>
+#include <utility>
+#include <assert.h>
+
+#define CACHE_LINE_SIZE 64
+
+template <typename T>
+class NodePool {
+public:
+    static constexpr size_t BLOCK_SIZE = (sizeof(T) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    static constexpr size_t SLAB_BLOCKS = 256; // Blocks carved per slab
+    static constexpr size_t BATCH_SIZE = 64;   // Blocks moved between threads at once
+
+    static void* allocate() {
+        Local& l = local;
+        if (l.free == nullptr) {
+            refill(l);
+        }
+        Block* b = l.free;
+        l.free = b->next;
+        l.count--;
+        return b;
+    }
+
+    static void deallocate(void* p) {
+        Local& l = local;
+        Block* b = static_cast<Block*>(p);
+        if (l.exited) {
+            // Called from another thread_local destructor after ours ran
+            b->next = nullptr;
+            push_batch(b, 1);
+            return;
+        }
+        b->next = l.free;
+        l.free = b;
+        if (++l.count >= 2 * BATCH_SIZE) {
+            release_batch(l);
+        }
+    }
+
+private:
+    struct Block {
+        Block* next;       // Next block in the thread-local list or batch
+        Block* next_batch; // Next batch on the shared stack, first block only
+        size_t batch_len;  // Number of blocks in the batch, first block only
+    };
+    static_assert(BLOCK_SIZE >= sizeof(Block), "node too small for the free list links");
+
+    // Trivially destructible so that it can still be used from thread_local
+    // destructors that run after Flusher's
+    struct Local {
+        Block* free;
+        size_t count;
+        bool exited;
+    };
+
+    // Gives the blocks of an exiting thread back to the shared stack
+    struct Flusher {
+        ~Flusher() {
+            Local& l = local;
+            while (l.free != nullptr) {
+                Block* head = l.free;
+                Block* tail = head;
+                size_t n = 1;
+                for (; n < BATCH_SIZE && tail->next != nullptr; ++n) {
+                    tail = tail->next;
+                }
+                l.free = tail->next;
+                tail->next = nullptr;
+                push_batch(head, n);
+            }
+            l.count = 0;
+            l.exited = true;
+        }
+    };
+
+    static inline thread_local Local local{nullptr, 0, false};
+    static inline thread_local Flusher flusher;
+    static inline atomic_tagged<Block> batches; // Shared stack of BATCH_SIZE-long chains
+
+    static void push_batch(Block* head, size_t n) {
+        head->batch_len = n;
+        tagged_ptr<Block> old_top;
+        do {
+            old_top = batches.load(ACQUIRE);
+            std::atomic_ref<Block*>(head->next_batch).store(old_top.ptr, RELAXED);
+        } while (!cas(batches, old_top, head));
+    }
+
+    static Block* pop_batch() {
+        tagged_ptr<Block> old_top;
+        do {
+            old_top = batches.load(ACQUIRE);
+            if (old_top.ptr == nullptr) {
+                return nullptr;
+            }
+            // old_top may be taken and reused concurrently; the blocks stay
+            // mapped and the tag makes the CAS fail in that case
+        } while (!cas(batches, old_top, std::atomic_ref<Block*>(old_top.ptr->next_batch).load(RELAXED)));
+        return old_top.ptr;
+    }
+
+    static void refill(Local& l) {
+        (void)&flusher; // Construct the flusher on first use by this thread
+        if (Block* b = pop_batch()) {
+            l.free = b;
+            l.count = b->batch_len;
+            return;
+        }
+        char* slab = static_cast<char*>(::operator new(SLAB_BLOCKS * BLOCK_SIZE, std::align_val_t(CACHE_LINE_SIZE)));
+        for (size_t i = 0; i < SLAB_BLOCKS; ++i) {
+            Block* b = reinterpret_cast<Block*>(slab + i * BLOCK_SIZE);
+            b->next = l.free;
+            l.free = b;
+        }
+        l.count += SLAB_BLOCKS;
+    }
+
+    static void release_batch(Local& l) {
+        (void)&flusher;
+        Block* head = l.free;
+        Block* tail = head;
+        for (size_t i = 1; i < BATCH_SIZE; ++i) {
+            tail = tail->next;
+        }
+        l.free = tail->next;
+        tail->next = nullptr;
+        l.count -= BATCH_SIZE;
+        push_batch(head, BATCH_SIZE);
+    }
+};
+
+/** Base class routing new/delete of Derived through NodePool<Derived> */
+template <typename Derived>
+struct PoolAllocated {
+    static void* operator new(size_t size) {
+        assert(size == sizeof(Derived));
+        return NodePool<Derived>::allocate();
+    }
+    static void operator delete(void* p) {
+        NodePool<Derived>::deallocate(p);
+    }
+};
+
+/** Uninitialized inline storage for one T inside a node.
+ *
+ * The value is constructed when the node is filled and moved out (and
+ * destroyed) by the one thread that removes it, so T only has to be
+ * movable. Nodes that never carry a value (queue dummies) simply leave the
+ * storage empty. Pointers and small PODs take no more room than the plain
+ * field did and need no extra allocation.
+ */
+template <typename T>
+struct NodeValue {
+    alignas(T) unsigned char buf[sizeof(T)];
+
+    template <typename... Args>
+    void emplace(Args&&... args) { new (buf) T(std::forward<Args>(args)...); }
+
+    T& get() { return *std::launder(reinterpret_cast<T*>(buf)); }
+
+    /** Moves the value out and ends its lifetime */
+    T take() {
+        T v = std::move(get());
+        get().~T();
+        return v;
+    }
+
+    void destroy() { get().~T(); }
+};
+
+#endif // NODE_POOL_H
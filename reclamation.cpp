@@ -0,0 +1,274 @@
+/*****************************************************************
+ * @author Suraj Ajjampur
+ * @file   reclamation.cpp
+ *
+ * @brief This C++ source file implements the hazard pointer domain and
+ *        the epoch-based reclamation used by the lock-free containers to
+ *        free unlinked nodes.
+ *
+ * @date 16 Oct 2026
+********************************************************************/
+
+#include "reclamation.h"
+#include <algorithm>
+
+namespace {
+
+struct Retired {
+    void* ptr;
+    void (*deleter)(void*);
+};
+
+// Singly linked list of every hazard record ever created. Records are
+// never freed; a thread that exits marks its record inactive so that the
+// next new thread can take it over.
+atomic<HazardPointers::Record*> hp_head{nullptr};
+atomic<int> hp_num_records{0};
+
+// Nodes retired by threads that exited before they could free them.
+// Adopted by whichever thread scans next.
+std::mutex orphans_lock;
+std::vector<Retired> orphans;
+
+HazardPointers::Record* acquire_record() {
+    // Reuse a record released by an exited thread if there is one
+    for (auto* r = hp_head.load(ACQUIRE); r != nullptr; r = r->next) {
+        if (!r->active.load(RELAXED) && cas(r->active, false, true, ACQ_REL)) {
+            return r;
+        }
+    }
+    auto* r = new HazardPointers::Record();
+    HazardPointers::Record* old_head;
+    do {
+        old_head = hp_head.load(ACQUIRE);
+        r->next = old_head;
+    } while (!cas(hp_head, old_head, r, ACQ_REL));
+    hp_num_records.fetch_add(1, RELAXED);
+    return r;
+}
+
+struct ThreadState {
+    HazardPointers::Record* rec = nullptr;
+    std::vector<Retired> retired;
+
+    HazardPointers::Record* record() {
+        if (rec == nullptr) rec = acquire_record();
+        return rec;
+    }
+
+    ~ThreadState() {
+        if (!retired.empty()) HazardPointers::scan();
+        if (!retired.empty()) {
+            std::lock_guard<std::mutex> lock(orphans_lock);
+            orphans.insert(orphans.end(), retired.begin(), retired.end());
+        }
+        if (rec != nullptr) {
+            for (auto& h : rec->hazard) h.store(nullptr, RELAXED);
+            rec->active.store(false, RELEASE);
+        }
+    }
+};
+
+thread_local ThreadState hp_thread;
+
+// Scan once the retire list holds about twice as many nodes as there are
+// hazard slots, so at least half of every scan is reclaimed.
+size_t scan_threshold() {
+    return 2 * hp_num_records.load(RELAXED) * HazardPointers::SLOTS_PER_THREAD + 64;
+}
+
+} // namespace
+
+HazardPointers::Guard::Guard() : rec(hp_thread.record()) {}
+
+HazardPointers::Guard::~Guard() {
+    for (auto& h : rec->hazard) h.store(nullptr, RELEASE);
+}
+
+/** Adds p to the calling thread's retire list and runs a scan when the
+ *  list has grown past the threshold.
+ *
+ * @param p       Node that is no longer reachable from the container
+ * @param deleter Function that frees p once it is safe to do so
+ */
+void HazardPointers::retire_node(void* p, void (*deleter)(void*)) {
+    hp_thread.retired.push_back({p, deleter});
+    if (hp_thread.retired.size() >= scan_threshold()) {
+        scan();
+    }
+}
+
+/** Frees every node on the calling thread's retire list that is not
+ *  currently published in any hazard slot.
+ */
+void HazardPointers::scan() {
+    {
+        std::lock_guard<std::mutex> lock(orphans_lock);
+        if (!orphans.empty()) {
+            hp_thread.retired.insert(hp_thread.retired.end(), orphans.begin(), orphans.end());
+            orphans.clear();
+        }
+    }
+
+    // Pairs with the SEQ_CST publish in Guard::protect - a hazard stored
+    // before the node was unlinked is visible to the reads below.
+    atomic_thread_fence(SEQ_CST);
+
+    std::vector<void*> hazards;
+    for (auto* r = hp_head.load(ACQUIRE); r != nullptr; r = r->next) {
+        for (auto& h : r->hazard) {
+            void* p = h.load(ACQUIRE);
+            if (p != nullptr) hazards.push_back(p);
+        }
+    }
+    std::sort(hazards.begin(), hazards.end());
+
+    std::vector<Retired> keep;
+    for (auto& r : hp_thread.retired) {
+        if (std::binary_search(hazards.begin(), hazards.end(), r.ptr)) {
+            keep.push_back(r);
+        } else {
+            r.deleter(r.ptr);
+        }
+    }
+    hp_thread.retired.swap(keep);
+}
+
+namespace {
+
+struct EpochRetired {
+    void* ptr;
+    void (*deleter)(void*);
+    uint64_t epoch;
+};
+
+atomic<uint64_t> global_epoch{0};
+atomic<EpochReclaimer::Record*> ebr_head{nullptr};
+
+std::mutex ebr_orphans_lock;
+std::vector<EpochRetired> ebr_orphans;
+
+// Attempt to advance the epoch (and free what has become safe) every this
+// many retires.
+constexpr size_t EBR_COLLECT_INTERVAL = 64;
+
+EpochReclaimer::Record* acquire_epoch_record() {
+    for (auto* r = ebr_head.load(ACQUIRE); r != nullptr; r = r->next) {
+        if (!r->in_use.load(RELAXED) && cas(r->in_use, false, true, ACQ_REL)) {
+            return r;
+        }
+    }
+    auto* r = new EpochReclaimer::Record();
+    EpochReclaimer::Record* old_head;
+    do {
+        old_head = ebr_head.load(ACQUIRE);
+        r->next = old_head;
+    } while (!cas(ebr_head, old_head, r, ACQ_REL));
+    return r;
+}
+
+struct EpochThreadState {
+    EpochReclaimer::Record* rec = nullptr;
+    std::vector<EpochRetired> retired;
+    size_t since_collect = 0;
+    uint64_t collected_epoch = 0; // Global epoch seen by the last collect
+
+    EpochReclaimer::Record* record() {
+        if (rec == nullptr) rec = acquire_epoch_record();
+        return rec;
+    }
+
+    ~EpochThreadState() {
+        if (!retired.empty()) EpochReclaimer::collect();
+        if (!retired.empty()) {
+            std::lock_guard<std::mutex> lock(ebr_orphans_lock);
+            ebr_orphans.insert(ebr_orphans.end(), retired.begin(), retired.end());
+        }
+        if (rec != nullptr) {
+            rec->epoch.store(0, RELAXED);
+            rec->in_use.store(false, RELEASE);
+        }
+    }
+};
+
+thread_local EpochThreadState ebr_thread;
+
+} // namespace
+
+/** Announces the current global epoch. Nested guards only announce once. */
+EpochReclaimer::Guard::Guard() : rec(ebr_thread.record()) {
+    if (rec->nesting++ == 0) {
+        uint64_t e = global_epoch.load(RELAXED);
+        // SEQ_CST so that try_advance cannot miss this announcement while
+        // we go on to read nodes retired in an older epoch
+        rec->epoch.store((e << 1) | 1, SEQ_CST);
+    }
+}
+
+EpochReclaimer::Guard::~Guard() {
+    if (--rec->nesting == 0) {
+        rec->epoch.store(0, RELEASE);
+    }
+}
+
+/** Tags p with the current epoch and adds it to the calling thread's
+ *  limbo list. Every EBR_COLLECT_INTERVAL retires the thread tries to move
+ *  the epoch forward and, if it has moved since the last collect, frees
+ *  what has become unreachable. While a stalled reader pins the epoch the
+ *  limbo list is therefore not rescanned on every interval.
+ *
+ * @param p       Node that is no longer reachable from the container
+ * @param deleter Function that frees p once it is safe to do so
+ */
+void EpochReclaimer::retire_node(void* p, void (*deleter)(void*)) {
+    ebr_thread.retired.push_back({p, deleter, global_epoch.load(ACQUIRE)});
+    if (++ebr_thread.since_collect >= EBR_COLLECT_INTERVAL) {
+        ebr_thread.since_collect = 0;
+        try_advance();
+        if (global_epoch.load(ACQUIRE) != ebr_thread.collected_epoch) {
+            collect();
+        }
+    }
+}
+
+/** Moves the global epoch from e to e + 1 if every thread currently inside
+ *  an operation has announced e.
+ *
+ * @return true if the epoch was advanced by this or another thread
+ */
+bool EpochReclaimer::try_advance() {
+    uint64_t e = global_epoch.load(SEQ_CST);
+    for (auto* r = ebr_head.load(ACQUIRE); r != nullptr; r = r->next) {
+        uint64_t announced = r->epoch.load(SEQ_CST);
+        if ((announced & 1) && (announced >> 1) != e) {
+            return false; // Someone is still reading in an older epoch
+        }
+    }
+    uint64_t expected = e;
+    return global_epoch.compare_exchange_strong(expected, e + 1, ACQ_REL) || expected != e;
+}
+
+/** Frees every node on the calling thread's limbo list that was retired at
+ *  least two epochs ago.
+ */
+void EpochReclaimer::collect() {
+    {
+        std::lock_guard<std::mutex> lock(ebr_orphans_lock);
+        if (!ebr_orphans.empty()) {
+            ebr_thread.retired.insert(ebr_thread.retired.end(), ebr_orphans.begin(), ebr_orphans.end());
+            ebr_orphans.clear();
+        }
+    }
+
+    uint64_t e = global_epoch.load(ACQUIRE);
+    ebr_thread.collected_epoch = e;
+    std::vector<EpochRetired> keep;
+    for (auto& r : ebr_thread.retired) {
+        if (r.epoch + 2 <= e) {
+            r.deleter(r.ptr);
+        } else {
+            keep.push_back(r);
+        }
+    }
+    ebr_thread.retired.swap(keep);
+}
@@ -0,0 +1,208 @@
+/*****************************************************************
+ * @author Suraj Ajjampur
+ * @file   reclamation.h
+ *
+ * @brief This C++ header file declares the safe memory reclamation
+ *        schemes used by the lock-free containers (tstack, msqueue).
+ *
+ * A node that has been unlinked from a lock-free structure can still be
+ * read by threads that loaded a pointer to it before the unlink. Every
+ * scheme below exposes the same policy interface so that a container can
+ * take it as a template parameter:
+ *
+ *   Reclaimer::Guard          RAII object held for one operation
+ *   Guard::protect(i, src)    load src and keep the node safe to read
+ *   Guard::set(i, p)          publish p, caller re-validates it
+ *   Reclaimer::retire(p)      hand over an unlinked node for freeing
+ *   Reclaimer::recycles       true if the container may free unlinked
+ *                             nodes immediately instead of retiring them
+ *
+ * Hazard pointer guards must not be nested on the same thread.
+ *
+ * The scheme a container uses when none is named is picked at compile
+ * time with -DRECLAMATION=<0,1,2> (see DefaultReclaimer below).
+ *
+ * @date 16 Oct 2026
+********************************************************************/
+
+#ifndef RECLAMATION_H
+#define RECLAMATION_H
+
+#include "my_atomics.h"
+#include <cstdint>
+#include <vector>
+
+/** Reclamation disabled - unlinked nodes are leaked. This is the
+ *  behaviour the containers had before reclamation was added and it is
+ *  kept as the baseline for benchmarking.
+ */
+struct NoReclamation {
+    static constexpr const char* name = "none";
+    static constexpr bool recycles = false;
+
+    class Guard {
+    public:
+        template <typename N>
+        N* protect(int, const atomic<N*>& src) { return src.load(ACQUIRE); }
+        void set(int, void*) {}
+        void clear(int) {}
+    };
+
+    template <typename N>
+    static void retire(N*) {} // Leaked on purpose
+};
+
+/** Immediate recycling - an unlinked node is freed straight back to the
+ *  node pool and reused by the next insert, with no protection on the read
+ *  side and no deferred freeing.
+ *
+ *  Only valid for containers that update every shared pointer with a
+ *  tagged CAS (tstack, tstack_e). A stale reader may still load from a
+ *  recycled node; NodePool never returns memory to the system so the read
+ *  cannot fault, and any CAS based on what it read fails because the tag
+ *  has moved on.
+ */
+struct TaggedRecycling {
+    static constexpr const char* name = "recycle";
+    static constexpr bool recycles = true;
+
+    class Guard {
+    public:
+        template <typename N>
+        N* protect(int, const atomic<N*>& src) { return src.load(ACQUIRE); }
+        void set(int, void*) {}
+        void clear(int) {}
+    };
+
+    template <typename N>
+    static void retire(N* p) { delete p; } // Containers free directly instead
+};
+
+/** Hazard pointers (Michael 2004)
+ *
+ * Each thread owns a record with SLOTS_PER_THREAD hazard slots. Before
+ * dereferencing a shared node a thread publishes its address in one of
+ * its slots and re-validates that the node is still reachable. Retired
+ * nodes go to a thread-local list; once the list grows past a threshold
+ * proportional to the total number of slots, a scan frees every node that
+ * no slot points to. The amortized cost of a scan is O(1) per retire.
+ */
+class HazardPointers {
+public:
+    static constexpr const char* name = "hazard";
+    static constexpr bool recycles = false;
+    static constexpr int SLOTS_PER_THREAD = 3;
+
+    struct alignas(64) Record {
+        atomic<void*> hazard[SLOTS_PER_THREAD];
+        atomic<bool> active;
+        Record* next; // Immutable once the record is linked in
+        Record() : active(true), next(nullptr) {
+            for (auto& h : hazard) h.store(nullptr, RELAXED);
+        }
+    };
+
+    class Guard {
+    public:
+        Guard();
+        ~Guard();
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        /** Loads src into slot i and retries until the published value is
+         *  still the one in src, i.e. the node was reachable after it was
+         *  made visible to scanners.
+         */
+        template <typename N>
+        N* protect(int i, const atomic<N*>& src) {
+            N* p = src.load(ACQUIRE);
+            while (true) {
+                rec->hazard[i].store(p, SEQ_CST);
+                N* q = src.load(SEQ_CST);
+                if (q == p) return p;
+                p = q;
+            }
+        }
+
+        void set(int i, void* p) { rec->hazard[i].store(p, SEQ_CST); }
+        void clear(int i) { rec->hazard[i].store(nullptr, RELEASE); }
+
+    private:
+        Record* rec;
+    };
+
+    template <typename N>
+    static void retire(N* p) {
+        retire_node(p, [](void* q) { delete static_cast<N*>(q); });
+    }
+
+    static void retire_node(void* p, void (*deleter)(void*));
+    static void scan();
+};
+
+/** Epoch-based reclamation (Fraser 2004)
+ *
+ * A thread announces the global epoch when it enters an operation and
+ * clears the announcement when it leaves, so the read side costs one store
+ * per operation instead of one fenced store per protected node. Retired
+ * nodes are tagged with the epoch they were retired in. The global epoch
+ * only advances once every active thread has announced it, so a node
+ * retired in epoch e can be freed once the global epoch reaches e + 2.
+ *
+ * The price is robustness: a thread stalled inside an operation keeps the
+ * epoch from advancing and nothing retired after that point is freed.
+ */
+class EpochReclaimer {
+public:
+    static constexpr const char* name = "epoch";
+    static constexpr bool recycles = false;
+
+    struct alignas(64) Record {
+        atomic<uint64_t> epoch; // (announced epoch << 1) | 1 while active, 0 when quiescent
+        atomic<bool> in_use;
+        int nesting;            // Only touched by the owning thread
+        Record* next;           // Immutable once the record is linked in
+        Record() : epoch(0), in_use(true), nesting(0), next(nullptr) {}
+    };
+
+    class Guard {
+    public:
+        Guard();
+        ~Guard();
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        template <typename N>
+        N* protect(int, const atomic<N*>& src) { return src.load(ACQUIRE); }
+        void set(int, void*) {}
+        void clear(int) {}
+
+    private:
+        Record* rec;
+    };
+
+    template <typename N>
+    static void retire(N* p) {
+        retire_node(p, [](void* q) { delete static_cast<N*>(q); });
+    }
+
+    static void retire_node(void* p, void (*deleter)(void*));
+    static bool try_advance();
+    static void collect();
+};
+
+// Reclamation scheme used when a container does not name one:
+// 0 = none (leak), 1 = hazard pointers, 2 = epochs
+#ifndef RECLAMATION
+#define RECLAMATION 1
+#endif
+
+#if RECLAMATION == 0
+using DefaultReclaimer = NoReclamation;
+#elif RECLAMATION == 2
+using DefaultReclaimer = EpochReclaimer;
+#else
+using DefaultReclaimer = HazardPointers;
+#endif
+
+#endif // RECLAMATION_H
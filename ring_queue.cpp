@@ -0,0 +1,100 @@
+/*****************************************************************
+ * @author Suraj Ajjampur
+ * @file   ring_queue.cpp
+ *
+ * @brief This C++ source file tests the bounded lock-free MPMC ring
+ *        queue.
+ *
+ * @date 16 Oct 2026
+********************************************************************/
+
+#include "ring_queue.h"
+#include <numeric>
+#include <vector>
+
+// Small enough that the test wraps around the ring and fills it
+#define RING_QUEUE_CAPACITY 64
+
+void testBasicRingQueueOperations() {
+    ringqueue<int> queue(4);
+    assert(queue.capacity() == 4);
+
+    // Fill the ring, one more does not fit
+    for (int i = 0; i < 4; ++i) {
+        assert(queue.try_enqueue(i));
+    }
+    assert(!queue.try_enqueue(4));
+
+    // Values come out in order and the freed slots are reused on the next lap
+    assert(*queue.dequeue() == 0);
+    assert(queue.try_enqueue(4));
+    for (int i = 1; i <= 4; ++i) {
+        int val;
+        assert(queue.try_dequeue(val) && val == i);
+    }
+    assert(!queue.dequeue());
+
+    std::cout << "Test Basic Ring Queue Operations: Passed" << std::endl;
+}
+
+/**
+ * @brief Tests the ring queue with a given set of values and a specified number of threads.
+ *
+ * Half of the threads enqueue their share of the values, the other half
+ * dequeue until every value has been taken out. The ring is much smaller
+ * than the input, so producers regularly find it full and wait for the
+ * consumers. The test passes if the sum of dequeued values matches the sum
+ * of the input.
+ *
+ * @param values A vector of integers to be enqueued into the queue.
+ * @param numThreads The total number of threads to be used for concurrent enqueue and dequeue operations.
+ */
+void ring_queue_test(std::vector<int>& values, int numThreads) {
+    ringqueue<int> queue(RING_QUEUE_CAPACITY);
+    std::atomic<int> sum(0);
+    std::atomic<size_t> dequeued(0);
+    std::vector<std::thread> threads;
+
+    int halfNumThreads = numThreads / 2;
+    if (halfNumThreads == 0) halfNumThreads = 1;
+
+    // Concurrent enqueues
+    for (int i = 0; i < halfNumThreads; ++i) {
+        threads.push_back(std::thread([&queue, &values, i, halfNumThreads]() {
+            for (size_t j = i; j < values.size(); j += halfNumThreads) {
+                queue.enqueue(values[j]);
+            }
+        }));
+    }
+
+    // Concurrent dequeues, until all values are out
+    for (int i = 0; i < halfNumThreads; ++i) {
+        threads.push_back(std::thread([&queue, &sum, &dequeued, &values]() {
+            int val;
+            while (dequeued.load(RELAXED) < values.size()) {
+                if (queue.try_dequeue(val)) {
+                    sum.fetch_add(val, RELAXED);
+                    dequeued.fetch_add(1, RELAXED);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+
+    // Wait for all threads to complete
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    // Calculate the expected sum of the vector
+    int expectedSum = std::accumulate(values.begin(), values.end(), 0);
+
+    // Check if the sum of dequeued values is correct
+    if (sum != expectedSum) {
+        std::cerr << "Error: The sum of dequeued values does not match the expected sum." << std::endl;
+        std::cerr << "Sum: " << sum << ", Expected: " << expectedSum << std::endl;
+    } else {
+        std::cout << "Test for ring queue passed !" << std::endl;
+    }
+}
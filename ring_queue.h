@@ -0,0 +1,166 @@
+/*****************************************************************
+ * @author Suraj Ajjampur
+ * @file   ring_queue.h
+ *
+ * @brief This C++ header file implements a bounded lock-free MPMC queue
+ *        on a ring buffer with a sequence number per slot (Vyukov).
+ *
+ * The ring is allocated once in the constructor; enqueue and dequeue never
+ * allocate. Each slot's sequence number says whose turn it is:
+ *
+ *   seq == pos            free, the producer that claims pos may fill it
+ *   seq == pos + 1        full, the consumer that claims pos may empty it
+ *   seq == pos + capacity free again for the producer one lap later
+ *
+ * A position is claimed with a CAS on enqueue_pos/dequeue_pos, so
+ * producers and consumers only contend among themselves, and a value is
+ * handed over through its slot with a single release/acquire pair.
+ *
+ * @date 16 Oct 2026
+********************************************************************/
+
+#ifndef RING_QUEUE_H
+#define RING_QUEUE_H
+
+#include "my_atomics.h"
+#include "node_pool.h"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <assert.h>
+
+/** Bounded lock-free multi-producer multi-consumer queue
+ *
+ * @tparam T Type of the values, only needs to be movable
+ */
+template <typename T>
+class ringqueue {
+public:
+    explicit ringqueue(size_t capacity);
+    ~ringqueue();
+
+    template <typename U>
+    bool try_enqueue(U&& val);
+    void enqueue(T val);
+    bool try_dequeue(T& out);
+    std::optional<T> dequeue();
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct cell {
+        std::atomic<size_t> seq;
+        NodeValue<T> val;
+    };
+
+    std::unique_ptr<cell[]> buffer;
+    const size_t mask;
+    // Producers and consumers each get their own cache line
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueue_pos;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeue_pos;
+};
+
+/** Rounds n up to a power of two so that a position maps to its slot with a mask */
+inline size_t ring_capacity(size_t n) {
+    size_t c = 1;
+    while (c < n) c <<= 1;
+    return c;
+}
+
+/** @param capacity Maximum number of values held, rounded up to a power of two */
+template <typename T>
+ringqueue<T>::ringqueue(size_t capacity)
+    : buffer(new cell[ring_capacity(capacity < 2 ? 2 : capacity)]),
+      mask(ring_capacity(capacity < 2 ? 2 : capacity) - 1),
+      enqueue_pos(0), dequeue_pos(0) {
+    for (size_t i = 0; i <= mask; ++i) {
+        buffer[i].seq.store(i, RELAXED);
+    }
+}
+
+/** Destroys the values still in the ring. Must not run concurrently with
+ *  any other operation.
+ */
+template <typename T>
+ringqueue<T>::~ringqueue() {
+    for (size_t pos = dequeue_pos.load(RELAXED); pos != enqueue_pos.load(RELAXED); ++pos) {
+        buffer[pos & mask].val.destroy();
+    }
+}
+
+/** Enqueues val unless the ring is full
+ *
+ * @param val Moved (or copied) into the ring only on success
+ * @return false if the ring is full
+ */
+template <typename T>
+template <typename U>
+bool ringqueue<T>::try_enqueue(U&& val) {
+    cell* c;
+    size_t pos = enqueue_pos.load(RELAXED);
+    while (true) {
+        c = &buffer[pos & mask];
+        size_t seq = c->seq.load(ACQUIRE);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            // Slot is free for this lap, claim the position
+            if (cas(enqueue_pos, pos, pos + 1, RELAXED)) break;
+            pos = enqueue_pos.load(RELAXED);
+        } else if (dif < 0) {
+            return false; // The consumer of the previous lap has not emptied it yet
+        } else {
+            pos = enqueue_pos.load(RELAXED); // Another producer took pos
+        }
+    }
+    c->val.emplace(std::forward<U>(val));
+    c->seq.store(pos + 1, RELEASE); // Hand the slot to the consumer of pos
+    return true;
+}
+
+/** Enqueues val, yielding while the ring is full */
+template <typename T>
+void ringqueue<T>::enqueue(T val) {
+    while (!try_enqueue(std::move(val))) {
+        std::this_thread::yield();
+    }
+}
+
+/** @return false if the ring is empty, out is then left untouched */
+template <typename T>
+bool ringqueue<T>::try_dequeue(T& out) {
+    std::optional<T> v = dequeue();
+    if (!v) {
+        return false;
+    }
+    out = std::move(*v);
+    return true;
+}
+
+/** @return The oldest value, or nothing if the ring is empty */
+template <typename T>
+std::optional<T> ringqueue<T>::dequeue() {
+    cell* c;
+    size_t pos = dequeue_pos.load(RELAXED);
+    while (true) {
+        c = &buffer[pos & mask];
+        size_t seq = c->seq.load(ACQUIRE);
+        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (dif == 0) {
+            if (cas(dequeue_pos, pos, pos + 1, RELAXED)) break;
+            pos = dequeue_pos.load(RELAXED);
+        } else if (dif < 0) {
+            return std::nullopt; // The producer of pos has not filled it yet
+        } else {
+            pos = dequeue_pos.load(RELAXED);
+        }
+    }
+    std::optional<T> ret(c->val.take());
+    c->seq.store(pos + mask + 1, RELEASE); // Free the slot for the producer one lap later
+    return ret;
+}
+
+void testBasicRingQueueOperations();
+void ring_queue_test(std::vector<int>& values, int numThreads);
+
+#endif // RING_QUEUE_H
@@ -10,47 +10,37 @@
 
 #include "sgl.h"
 
-
-void SGLQueue::enqueue(int val) {
-    std::lock_guard<std::mutex> lock(sgl);
-    q.push_back(val);
-}
-
-int SGLQueue::dequeue() {
-    std::lock_guard<std::mutex> lock(sgl);
-    if (q.empty()) {
-        // Handle empty queue, e.g., throw an exception or return a special value
-        return -1;  // Example: return -1 to indicate an empty queue
-    }
-    int ret = q.front();
-    q.pop_front();
-    return ret;
+void print_critical_section_stats(const CriticalSectionStats& chunked, const CriticalSectionStats& list) {
+    std::cout << "Critical section: " << chunked.average() << " cycles/op with chunked storage, "
+              << list.average() << " cycles/op with std::list" << std::endl;
 }
 
-void concurrentSGLQueueEnqueue(SGLQueue& queue, int val) {
+template <typename Queue>
+void concurrentSGLQueueEnqueue(Queue& queue, int val) {
     queue.enqueue(val);
 }
 
-void concurrentSGLQueueDequeue(SGLQueue& queue, std::atomic<int>& sum) {
-    int val = queue.dequeue();
-    if (val != -1) { // Assuming -1 indicates an empty queue
+template <typename Queue>
+void concurrentSGLQueueDequeue(Queue& queue, std::atomic<int>& sum) {
+    int val;
+    if (queue.try_dequeue(val)) {
         sum.fetch_add(val, RELAXED);
     }
 }
 
 void testConcurrentSGLQueueOperations() {
-    SGLQueue queue;
+    SGLQueue<int> queue;
     std::atomic<int> sum(0);
     std::vector<std::thread> threads;
 
     // Start threads to perform concurrent enqueues
     for (int i = 1; i <= 5; ++i) {
-        threads.push_back(std::thread(concurrentSGLQueueEnqueue, std::ref(queue), i));
+        threads.push_back(std::thread(concurrentSGLQueueEnqueue<SGLQueue<int>>, std::ref(queue), i));
     }
 
     // Start threads to perform concurrent dequeues
     for (int i = 0; i < 5; ++i) {
-        threads.push_back(std::thread(concurrentSGLQueueDequeue, std::ref(queue), std::ref(sum)));
+        threads.push_back(std::thread(concurrentSGLQueueDequeue<SGLQueue<int>>, std::ref(queue), std::ref(sum)));
     }
 
     // Wait for all threads to complete
@@ -64,12 +54,13 @@ void testConcurrentSGLQueueOperations() {
     std::cout << "Test Concurrent SGL Queue Operations: Passed" << std::endl;
 }
 
-void sgl_queue_test(std::vector<int>& values, int numThreads) {
-    SGLQueue queue;
+template <typename Queue>
+static int run_sgl_queue(Queue& queue, std::vector<int>& values, int numThreads) {
     std::atomic<int> sum(0);
     std::vector<std::thread> threads;
 
     int halfNumThreads = numThreads / 2;
+    if (halfNumThreads == 0) halfNumThreads = 1;
 
     // Concurrent enqueues
     for (int i = 0; i < halfNumThreads; ++i) {
@@ -93,23 +84,37 @@ void sgl_queue_test(std::vector<int>& values, int numThreads) {
     for (auto& t : threads) {
         t.join();
     }
+    return sum.load();
+}
 
-    // Calculate the expected sum of the vector
-    int expectedSum = std::accumulate(values.begin(), values.end(), 0);
-
-    // Check if the sum of dequeued values is correct
-    if (sum != expectedSum) {
-        std::cerr << "Error: The sum of dequeued values does not match the expected sum." << std::endl;
-        std::cerr << "Sum: " << sum << ", Expected: " << expectedSum << std::endl;
-    } else {
-        std::cout << "Test for SGL queue passed with no optimization" << std::endl;
-    }
+/**
+ * @brief Tests the SGL queue: half of the threads enqueue their share of the values, the
+ *        other half dequeue as many times, then the sum of the dequeued values is checked.
+ *
+ * The queue uses the lock chosen with --lock.
+ */
+void sgl_queue_test(std::vector<int>& values, int numThreads, LockKind lock) {
+    with_lock(lock, [&]<typename Lock>() {
+        SGLQueue<int, ChunkedStorage<int>, Lock> queue;
+        int sum = run_sgl_queue(queue, values, numThreads);
+
+        // Calculate the expected sum of the vector
+        int expectedSum = std::accumulate(values.begin(), values.end(), 0);
+
+        // Check if the sum of dequeued values is correct
+        if (sum != expectedSum) {
+            std::cerr << "Error: The sum of dequeued values does not match the expected sum." << std::endl;
+            std::cerr << "Sum: " << sum << ", Expected: " << expectedSum << std::endl;
+        } else {
+            std::cout << "Test for SGL queue passed with no optimization (" << lock_name(lock) << " lock)" << std::endl;
+        }
+    });
 }
 
 
 
 void testBasicSGLQueueOperations() {
-    SGLQueue queue;
+    SGLQueue<int> queue;
 
     // Enqueue elements
     queue.enqueue(1);
@@ -122,7 +127,7 @@ void testBasicSGLQueueOperations() {
     assert(queue.dequeue() == 3);
 
     // Queue should be empty now
-    assert(queue.dequeue() == -1); // Assuming -1 indicates an empty queue
+    assert(!queue.dequeue());
 
     std::cout << "Test Basic SGL Queue Operations: Passed" << std::endl;
 }
@@ -131,44 +136,31 @@ void testBasicSGLQueueOperations() {
 
 
 
-void SGLStack::push(int val) {
-    std::lock_guard<std::mutex> lock(sgl);
-    q.push_back(val);
-}
-
-int SGLStack::pop() {
-    std::lock_guard<std::mutex> lock(sgl);
-    if (q.empty()) {
-        return -1;  //return -1 to indicate an empty queue
-    }
-    int ret = q.back();
-    q.pop_back();
-    return ret;
-}
-
-void concurrentSGLStackPush(SGLStack& stack, int val) {
+template <typename Stack>
+void concurrentSGLStackPush(Stack& stack, int val) {
     stack.push(val);
 }
 
-void concurrentSGLStackPop(SGLStack& stack, std::atomic<int>& popCount) {
-    if (stack.pop() != -1) {
+template <typename Stack>
+void concurrentSGLStackPop(Stack& stack, std::atomic<int>& popCount) {
+    if (stack.pop()) {
         popCount.fetch_add(1, RELAXED);
     }
 }
 
 void testConcurrentSGLStackOperations() {
-    SGLStack stack;
+    SGLStack<int> stack;
     std::atomic<int> popCount(0);
     std::vector<std::thread> threads;
 
     // Start threads to perform concurrent pushes
     for (int i = 0; i < 100; ++i) {
-        threads.push_back(std::thread(concurrentSGLStackPush, std::ref(stack), i));
+        threads.push_back(std::thread(concurrentSGLStackPush<SGLStack<int>>, std::ref(stack), i));
     }
 
     // Start threads to perform concurrent pops
     for (int i = 0; i < 100; ++i) {
-        threads.push_back(std::thread(concurrentSGLStackPop, std::ref(stack), std::ref(popCount)));
+        threads.push_back(std::thread(concurrentSGLStackPop<SGLStack<int>>, std::ref(stack), std::ref(popCount)));
     }
 
     // Wait for all threads to complete
@@ -182,12 +174,13 @@ void testConcurrentSGLStackOperations() {
     std::cout << "Test Concurrent SGL Stack Operations: Passed" << std::endl;
 }
 
-void sgl_stack_test(std::vector<int>& values, int numThreads) {
-    SGLStack stack;
+template <typename Stack>
+static int run_sgl_stack(Stack& stack, std::vector<int>& values, int numThreads) {
     std::atomic<int> popCount(0);
     std::vector<std::thread> threads;
 
     int halfNumThreads = numThreads / 2;
+    if (halfNumThreads == 0) halfNumThreads = 1;
 
     // Concurrent pushes
     for (int i = 0; i < halfNumThreads; ++i) {
@@ -214,13 +207,27 @@ void sgl_stack_test(std::vector<int>& values, int numThreads) {
     for (auto& t : threads) {
         t.join();
     }
+    return popCount.load();
+}
 
-    if (popCount.load(RELAXED) != values.size()) {
-        std::cerr << "Error: The number of successful pops does not match the number of pushes." << std::endl;
-        std::cerr << "Pops: " << popCount << ", Pushes: " << values.size() << std::endl;
-    } else {
-        std::cout << "Test for SGL stack passed with no optimization" << std::endl;
-    }
+/**
+ * @brief Tests the SGL stack: half of the threads push their share of the values, the
+ *        other half pop as many times, then the number of successful pops is checked.
+ *
+ * The stack uses the lock chosen with --lock.
+ */
+void sgl_stack_test(std::vector<int>& values, int numThreads, LockKind lock) {
+    with_lock(lock, [&]<typename Lock>() {
+        SGLStack<int, ChunkedStorage<int>, Lock> stack;
+        size_t popCount = run_sgl_stack(stack, values, numThreads);
+
+        if (popCount != values.size()) {
+            std::cerr << "Error: The number of successful pops does not match the number of pushes." << std::endl;
+            std::cerr << "Pops: " << popCount << ", Pushes: " << values.size() << std::endl;
+        } else {
+            std::cout << "Test for SGL stack passed with no optimization (" << lock_name(lock) << " lock)" << std::endl;
+        }
+    });
 }
 
 
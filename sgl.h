@@ -12,30 +12,300 @@
 #define SGL_H
 
 #include "my_atomics.h"
+#include "node_pool.h" // NodeValue
 #include <mutex>
 #include <list>
 #include <assert.h>
 #include <numeric>
+#include <optional>
+#include <x86intrin.h> // __rdtsc
 
+// Values per chunk of ChunkedStorage
+#define SGL_CHUNK_SIZE 256
+// Drained chunks ChunkedStorage keeps for reuse instead of freeing them
+#define SGL_SPARE_CHUNKS 4
+
+/** Sequence of values in a doubly linked list of fixed-size chunks, with
+ *  the part of std::list's interface the SGL containers use.
+ *
+ * Unlike std::list, a push does not allocate a node: it fills the next
+ * cell of the last chunk, and values sit next to each other in memory. A
+ * chunk that empties out goes to a small spare list, and the next chunk
+ * needed comes from there, so a queue or stack whose size stays within a
+ * few chunks of where it was never allocates again.
+ *
+ * Not thread-safe, the containers call it under their lock.
+ */
+template <typename T>
+class ChunkedStorage {
+public:
+    ChunkedStorage();
+    ~ChunkedStorage();
+    ChunkedStorage(const ChunkedStorage&) = delete;
+    ChunkedStorage& operator=(const ChunkedStorage&) = delete;
+
+    bool empty() const { return first == last && begin == end; }
+    T& front() { return first->cells[begin].get(); }
+    T& back() { return last->cells[end - 1].get(); }
+    void push_back(T val);
+    void pop_front();
+    void pop_back();
+
+private:
+    struct Chunk {
+        NodeValue<T> cells[SGL_CHUNK_SIZE];
+        Chunk* prev = nullptr;
+        Chunk* next = nullptr;
+    };
+
+    Chunk* take_chunk();
+    void give_chunk(Chunk* c);
+
+    Chunk* first;  // Holds the front
+    size_t begin;  // Cell of the front in first
+    Chunk* last;   // Holds the back
+    size_t end;    // One past the cell of the back in last, never 0 unless empty
+    Chunk* spare;  // Drained chunks, through next
+    size_t spares; // Length of spare
+};
+
+template <typename T>
+ChunkedStorage<T>::ChunkedStorage() : begin(0), end(0), spare(nullptr), spares(0) {
+    first = last = new Chunk();
+}
+
+/** Destroys the values left and frees every chunk */
+template <typename T>
+ChunkedStorage<T>::~ChunkedStorage() {
+    while (!empty()) {
+        pop_front();
+    }
+    delete first;
+    while (spare != nullptr) {
+        Chunk* c = spare;
+        spare = spare->next;
+        delete c;
+    }
+}
+
+/** @return A spare chunk, or a new one if there is none left */
+template <typename T>
+typename ChunkedStorage<T>::Chunk* ChunkedStorage<T>::take_chunk() {
+    if (spare == nullptr) {
+        return new Chunk();
+    }
+    Chunk* c = spare;
+    spare = c->next;
+    --spares;
+    c->next = nullptr;
+    return c;
+}
+
+template <typename T>
+void ChunkedStorage<T>::give_chunk(Chunk* c) {
+    if (spares == SGL_SPARE_CHUNKS) {
+        delete c; // Shrinking for good, don't hoard memory
+        return;
+    }
+    c->prev = nullptr;
+    c->next = spare;
+    spare = c;
+    ++spares;
+}
+
+template <typename T>
+void ChunkedStorage<T>::push_back(T val) {
+    if (end == SGL_CHUNK_SIZE) {
+        Chunk* c = take_chunk();
+        c->prev = last;
+        last->next = c;
+        last = c;
+        end = 0;
+    }
+    last->cells[end++].emplace(std::move(val));
+}
+
+template <typename T>
+void ChunkedStorage<T>::pop_front() {
+    assert(!empty());
+    first->cells[begin++].destroy();
+    if (first == last) {
+        if (begin == end) begin = end = 0; // Empty, start over at the top of the chunk
+    } else if (begin == SGL_CHUNK_SIZE) {
+        Chunk* c = first;
+        first = c->next;
+        first->prev = nullptr;
+        begin = 0;
+        give_chunk(c);
+    }
+}
+
+template <typename T>
+void ChunkedStorage<T>::pop_back() {
+    assert(!empty());
+    last->cells[--end].destroy();
+    if (first == last) {
+        if (begin == end) begin = end = 0;
+    } else if (end == 0) {
+        Chunk* c = last;
+        last = c->prev;
+        last->next = nullptr;
+        end = SGL_CHUNK_SIZE;
+        give_chunk(c);
+    }
+}
+
+/** Time spent holding the lock of one SGL container, in TSC cycles.
+ *  Written under the lock, read once the threads are done.
+ */
+struct CriticalSectionStats {
+    long ops;
+    unsigned long long cycles;
+
+    double average() const { return ops ? (double)cycles / ops : 0; }
+};
+
+/** Timer policy of the SGL containers that measures nothing, the default.
+ *  Its Section compiles away, so the critical sections are not lengthened.
+ */
+struct NullTimer {
+    struct Section {
+        explicit Section(NullTimer&) {}
+    };
+
+    CriticalSectionStats stats() const { return {}; }
+};
+
+/** Timer policy that adds up the time spent holding the lock with rdtsc,
+ *  for the benchmarks. A Section is declared right after the lock guard,
+ *  so that it ends before the unlock.
+ */
+class CriticalSectionTimer {
+public:
+    class Section {
+    public:
+        explicit Section(CriticalSectionTimer& timer) : totals(timer.totals), start(__rdtsc()) {}
+        ~Section() {
+            totals.cycles += __rdtsc() - start;
+            ++totals.ops;
+        }
+
+    private:
+        CriticalSectionStats& totals;
+        unsigned long long start;
+    };
+
+    CriticalSectionStats stats() const { return totals; }
+
+private:
+    CriticalSectionStats totals{};
+};
+
+/** Queue protected by a single global lock
+ *
+ * @tparam Storage Sequence of the values, ChunkedStorage or std::list
+ * @tparam Lock    The lock, std::mutex or a policy of my_atomics.h
+ *                 (TASLock, TTASLock, TicketLock, MCSLock)
+ * @tparam Timer   NullTimer, or CriticalSectionTimer to measure the
+ *                 critical sections
+ */
+template <typename T, typename Storage = ChunkedStorage<T>, typename Lock = std::mutex, typename Timer = NullTimer>
 class SGLQueue{
     private:
-        std::mutex sgl;
-        std::list<int> q;
+        Lock sgl;
+        Storage q;
+        [[no_unique_address]] Timer timing;
     public:
-        void enqueue(int val);
-        int dequeue();
+        void enqueue(T val);
+        bool try_dequeue(T& out);
+        std::optional<T> dequeue();
+
+        CriticalSectionStats criticalSectionStats() const { return timing.stats(); }
 };
 
+/** Stack protected by a single global lock
+ *
+ * @tparam Storage Sequence of the values, ChunkedStorage or std::list
+ * @tparam Lock    The lock, as for SGLQueue
+ * @tparam Timer   NullTimer or CriticalSectionTimer, as for SGLQueue
+ */
+template <typename T, typename Storage = ChunkedStorage<T>, typename Lock = std::mutex, typename Timer = NullTimer>
 class SGLStack{
     private:
-        std::mutex sgl;
-        std::list<int> q;
+        Lock sgl;
+        Storage q;
+        [[no_unique_address]] Timer timing;
     public:
-        void push(int val);
-        int pop();
+        void push(T val);
+        bool try_pop(T& out);
+        std::optional<T> pop();
+
+        CriticalSectionStats criticalSectionStats() const { return timing.stats(); }
 };
 
+template <typename T, typename Storage, typename Lock, typename Timer>
+void SGLQueue<T, Storage, Lock, Timer>::enqueue(T val) {
+    std::lock_guard<Lock> lock(sgl);
+    typename Timer::Section cs(timing);
+    q.push_back(std::move(val));
+}
+
+/** @return false if the queue is empty, out is then left untouched */
+template <typename T, typename Storage, typename Lock, typename Timer>
+bool SGLQueue<T, Storage, Lock, Timer>::try_dequeue(T& out) {
+    std::lock_guard<Lock> lock(sgl);
+    typename Timer::Section cs(timing);
+    if (q.empty()) {
+        return false;
+    }
+    out = std::move(q.front());
+    q.pop_front();
+    return true;
+}
 
+template <typename T, typename Storage, typename Lock, typename Timer>
+std::optional<T> SGLQueue<T, Storage, Lock, Timer>::dequeue() {
+    std::lock_guard<Lock> lock(sgl);
+    typename Timer::Section cs(timing);
+    if (q.empty()) {
+        return std::nullopt;
+    }
+    std::optional<T> ret(std::move(q.front()));
+    q.pop_front();
+    return ret;
+}
+
+template <typename T, typename Storage, typename Lock, typename Timer>
+void SGLStack<T, Storage, Lock, Timer>::push(T val) {
+    std::lock_guard<Lock> lock(sgl);
+    typename Timer::Section cs(timing);
+    q.push_back(std::move(val));
+}
+
+/** @return false if the stack is empty, out is then left untouched */
+template <typename T, typename Storage, typename Lock, typename Timer>
+bool SGLStack<T, Storage, Lock, Timer>::try_pop(T& out) {
+    std::lock_guard<Lock> lock(sgl);
+    typename Timer::Section cs(timing);
+    if (q.empty()) {
+        return false;
+    }
+    out = std::move(q.back());
+    q.pop_back();
+    return true;
+}
+
+template <typename T, typename Storage, typename Lock, typename Timer>
+std::optional<T> SGLStack<T, Storage, Lock, Timer>::pop() {
+    std::lock_guard<Lock> lock(sgl);
+    typename Timer::Section cs(timing);
+    if (q.empty()) {
+        return std::nullopt;
+    }
+    std::optional<T> ret(std::move(q.back()));
+    q.pop_back();
+    return ret;
+}
 
 void testBasicSGLQueueOperations();
 void testConcurrentSGLQueueOperations();
@@ -43,7 +313,9 @@ void testConcurrentSGLQueueOperations();
 void testBasicSGLStackOperations();
 void testConcurrentSGLStackOperations();
 
-void sgl_stack_test(std::vector<int>& values, int numThreads);
-void sgl_queue_test(std::vector<int>& values, int numThreads);
+void print_critical_section_stats(const CriticalSectionStats& chunked, const CriticalSectionStats& list);
+
+void sgl_stack_test(std::vector<int>& values, int numThreads, LockKind lock = MUTEX_LOCK);
+void sgl_queue_test(std::vector<int>& values, int numThreads, LockKind lock = MUTEX_LOCK);
 
 #endif
\ No newline at end of file
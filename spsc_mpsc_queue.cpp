@@ -0,0 +1,116 @@
+/*****************************************************************
+ * @author Suraj Ajjampur
+ * @file   spsc_mpsc_queue.cpp
+ *
+ * @brief This C++ source file tests the single-producer single-consumer
+ *        ring and the multi-producer single-consumer queue.
+ *
+ * @date 16 Oct 2026
+********************************************************************/
+
+#include "spsc_mpsc_queue.h"
+#include <numeric>
+#include <vector>
+
+// Small enough that the producer regularly finds the ring full
+#define SPSC_QUEUE_CAPACITY 64
+
+void testBasicSPSCMPSCQueueOperations() {
+    spscqueue<int> ring(2);
+    assert(ring.try_enqueue(-1));
+    assert(ring.try_enqueue(2));
+    assert(!ring.try_enqueue(3)); // Full
+    assert(*ring.dequeue() == -1);
+    assert(ring.try_enqueue(3)); // The freed slot is reused
+    int val;
+    assert(ring.try_dequeue(val) && val == 2);
+    assert(*ring.dequeue() == 3);
+    assert(!ring.dequeue());
+
+    mpscqueue<std::unique_ptr<int>> queue;
+    queue.enqueue(std::make_unique<int>(1));
+    queue.enqueue(std::make_unique<int>(2));
+    queue.enqueue(std::make_unique<int>(3)); // Left for the destructor
+    assert(**queue.dequeue() == 1);
+    assert(**queue.dequeue() == 2);
+
+    std::cout << "Test Basic SPSC/MPSC Queue Operations: Passed" << std::endl;
+}
+
+/** Runs producers enqueueing their share of values and one consumer
+ *  dequeueing all of them, then checks the sum.
+ */
+template <typename Queue>
+static int single_consumer_sum(Queue& queue, std::vector<int>& values, int producers) {
+    std::atomic<int> sum(0);
+    std::vector<std::thread> threads;
+
+    // Concurrent enqueues
+    for (int i = 0; i < producers; ++i) {
+        threads.push_back(std::thread([&queue, &values, i, producers]() {
+            for (size_t j = i; j < values.size(); j += producers) {
+                queue.enqueue(values[j]);
+            }
+        }));
+    }
+
+    // The single consumer, until all values are out
+    threads.push_back(std::thread([&queue, &sum, &values]() {
+        int val;
+        size_t dequeued = 0;
+        while (dequeued < values.size()) {
+            if (queue.try_dequeue(val)) {
+                sum.fetch_add(val, RELAXED);
+                ++dequeued;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }));
+
+    // Wait for all threads to complete
+    for (auto& t : threads) {
+        t.join();
+    }
+    return sum.load();
+}
+
+/**
+ * @brief Tests the SPSC ring with one producer and one consumer thread,
+ *        whatever numThreads is.
+ *
+ * @param values A vector of integers to be enqueued into the queue.
+ * @param numThreads Ignored, the queue only supports two threads.
+ */
+void spsc_queue_test(std::vector<int>& values, [[maybe_unused]] int numThreads) {
+    spscqueue<int> queue(SPSC_QUEUE_CAPACITY);
+    int sum = single_consumer_sum(queue, values, 1);
+    int expectedSum = std::accumulate(values.begin(), values.end(), 0);
+
+    if (sum != expectedSum) {
+        std::cerr << "Error: The sum of dequeued values does not match the expected sum." << std::endl;
+        std::cerr << "Sum: " << sum << ", Expected: " << expectedSum << std::endl;
+    } else {
+        std::cout << "Test for SPSC queue passed !" << std::endl;
+    }
+}
+
+/**
+ * @brief Tests the MPSC queue with numThreads - 1 producers and one consumer.
+ *
+ * @param values A vector of integers to be enqueued into the queue.
+ * @param numThreads The total number of threads, one of which is the consumer.
+ */
+void mpsc_queue_test(std::vector<int>& values, int numThreads) {
+    mpscqueue<int> queue;
+    int producers = numThreads > 1 ? numThreads - 1 : 1;
+    int sum = single_consumer_sum(queue, values, producers);
+    int expectedSum = std::accumulate(values.begin(), values.end(), 0);
+
+    if (sum != expectedSum) {
+        std::cerr << "Error: The sum of dequeued values does not match the expected sum." << std::endl;
+        std::cerr << "Sum: " << sum << ", Expected: " << expectedSum << std::endl;
+    } else {
+        std::cout << "Test for MPSC queue passed !" << std::endl;
+    }
+}
@@ -0,0 +1,237 @@
+/*****************************************************************
+ * @author Suraj Ajjampur
+ * @file   spsc_mpsc_queue.h
+ *
+ * @brief This C++ header file implements two queues specialized for a
+ *        single consumer: a bounded single-producer single-consumer ring
+ *        and an unbounded multi-producer single-consumer linked queue.
+ *
+ * Both have the same interface as the other queues (enqueue, try_dequeue,
+ * dequeue), but the calling side that is single must really be a single
+ * thread at a time. In exchange neither uses a CAS:
+ *
+ *  spscqueue  Each side owns one index and keeps a cached copy of the
+ *             other side's index, so it only reads the shared counter
+ *             (and takes the cache miss) when the cached copy says the
+ *             ring is full or empty. Both sides are wait-free.
+ *
+ *  mpscqueue  Vyukov's exchange-based queue. A producer swaps itself in
+ *             as the new tail with one exchange and then links the old
+ *             tail to its node, so enqueue is wait-free whatever the
+ *             number of producers. The consumer owns head outright and
+ *             frees nodes itself, with no reclamation scheme needed.
+ *
+ * @date 16 Oct 2026
+********************************************************************/
+
+#ifndef SPSC_MPSC_QUEUE_H
+#define SPSC_MPSC_QUEUE_H
+
+#include "my_atomics.h"
+#include "node_pool.h"
+#include "ring_queue.h" // ring_capacity
+#include <memory>
+#include <optional>
+#include <thread>
+#include <assert.h>
+
+/** Bounded wait-free single-producer single-consumer ring
+ *
+ * @tparam T Type of the values, only needs to be movable
+ */
+template <typename T>
+class spscqueue {
+public:
+    explicit spscqueue(size_t capacity);
+    ~spscqueue();
+
+    template <typename U>
+    bool try_enqueue(U&& val);
+    void enqueue(T val);
+    bool try_dequeue(T& out);
+    std::optional<T> dequeue();
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    std::unique_ptr<NodeValue<T>[]> buffer;
+    const size_t mask;
+
+    // Producer side: written by the producer, tail read by the consumer
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail;
+    size_t cached_head; // Producer's last view of head
+    // Consumer side: written by the consumer, head read by the producer
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head;
+    size_t cached_tail; // Consumer's last view of tail
+};
+
+/** @param capacity Maximum number of values held, rounded up to a power of two */
+template <typename T>
+spscqueue<T>::spscqueue(size_t capacity)
+    : buffer(new NodeValue<T>[ring_capacity(capacity)]),
+      mask(ring_capacity(capacity) - 1),
+      tail(0), cached_head(0), head(0), cached_tail(0) {}
+
+/** Destroys the values still in the ring. Must not run concurrently with
+ *  any other operation.
+ */
+template <typename T>
+spscqueue<T>::~spscqueue() {
+    for (size_t pos = head.load(RELAXED); pos != tail.load(RELAXED); ++pos) {
+        buffer[pos & mask].destroy();
+    }
+}
+
+/** Producer only. Enqueues val unless the ring is full
+ *
+ * @param val Moved (or copied) into the ring only on success
+ * @return false if the ring is full
+ */
+template <typename T>
+template <typename U>
+bool spscqueue<T>::try_enqueue(U&& val) {
+    size_t t = tail.load(RELAXED);
+    if (t - cached_head > mask) {
+        cached_head = head.load(ACQUIRE); // Looks full, refresh the view of the consumer
+        if (t - cached_head > mask) {
+            return false;
+        }
+    }
+    buffer[t & mask].emplace(std::forward<U>(val));
+    tail.store(t + 1, RELEASE); // Publish the value to the consumer
+    return true;
+}
+
+/** Producer only. Enqueues val, yielding while the ring is full */
+template <typename T>
+void spscqueue<T>::enqueue(T val) {
+    while (!try_enqueue(std::move(val))) {
+        std::this_thread::yield();
+    }
+}
+
+/** Consumer only. @return The oldest value, or nothing if the ring is empty */
+template <typename T>
+std::optional<T> spscqueue<T>::dequeue() {
+    size_t h = head.load(RELAXED);
+    if (h == cached_tail) {
+        cached_tail = tail.load(ACQUIRE); // Looks empty, refresh the view of the producer
+        if (h == cached_tail) {
+            return std::nullopt;
+        }
+    }
+    std::optional<T> ret(buffer[h & mask].take());
+    head.store(h + 1, RELEASE); // Give the slot back to the producer
+    return ret;
+}
+
+/** Consumer only. @return false if the ring is empty, out is then left untouched */
+template <typename T>
+bool spscqueue<T>::try_dequeue(T& out) {
+    std::optional<T> v = dequeue();
+    if (!v) {
+        return false;
+    }
+    out = std::move(*v);
+    return true;
+}
+
+/** Unbounded multi-producer single-consumer queue with a wait-free enqueue
+ *
+ * @tparam T Type of the values, only needs to be movable
+ */
+template <typename T>
+class mpscqueue {
+public:
+    struct node : PoolAllocated<node> { // Allocated from the per-thread node pool
+        NodeValue<T> val;
+        std::atomic<node*> next;
+        node() : next(nullptr) {} // Dummy, carries no value
+        template <typename U>
+        node(U&& v) : next(nullptr) { val.emplace(std::forward<U>(v)); }
+    };
+
+    mpscqueue();
+    ~mpscqueue();
+    void enqueue(T val);
+    bool try_dequeue(T& out);
+    std::optional<T> dequeue();
+
+private:
+    alignas(CACHE_LINE_SIZE) std::atomic<node*> tail; // Swapped by producers
+    alignas(CACHE_LINE_SIZE) node* head;              // Dummy, owned by the consumer
+};
+
+template <typename T>
+mpscqueue<T>::mpscqueue() {
+    node* dummy = new node();
+    head = dummy;
+    tail.store(dummy, RELAXED);
+}
+
+/** Frees the dummy and every node still in the queue. Must not run
+ *  concurrently with any other operation.
+ */
+template <typename T>
+mpscqueue<T>::~mpscqueue() {
+    node* h = head;
+    bool dummy = true;
+    while (h != nullptr) {
+        node* n = h->next.load(RELAXED);
+        if (!dummy) h->val.destroy();
+        dummy = false;
+        delete h;
+        h = n;
+    }
+}
+
+/** Any number of producers. Wait-free: one exchange and one store
+ *
+ * @param val Value to be enqueued, moved into the node
+ */
+template <typename T>
+void mpscqueue<T>::enqueue(T val) {
+    node* n = new node(std::move(val));
+    node* prev = tail.exchange(n, ACQ_REL); // Linearization point among producers
+    // Until this store the consumer sees the queue end at prev
+    prev->next.store(n, RELEASE);
+}
+
+/** Consumer only.
+ *
+ * A producer that has swapped tail but not yet linked its predecessor
+ * hides its own value and every later one until it does, and dequeue
+ * reports empty meanwhile. That window is two instructions long.
+ *
+ * @return The oldest linked value, or nothing if there is none
+ */
+template <typename T>
+std::optional<T> mpscqueue<T>::dequeue() {
+    node* h = head;
+    node* n = h->next.load(ACQUIRE);
+    if (n == nullptr) {
+        return std::nullopt;
+    }
+    std::optional<T> ret(n->val.take());
+    head = n; // n becomes the dummy
+    // No producer touches h any more: its next is set, and tail moved past it
+    delete h;
+    return ret;
+}
+
+/** Consumer only. @return false if the queue is empty, out is then left untouched */
+template <typename T>
+bool mpscqueue<T>::try_dequeue(T& out) {
+    std::optional<T> v = dequeue();
+    if (!v) {
+        return false;
+    }
+    out = std::move(*v);
+    return true;
+}
+
+void testBasicSPSCMPSCQueueOperations();
+void spsc_queue_test(std::vector<int>& values, int numThreads);
+void mpsc_queue_test(std::vector<int>& values, int numThreads);
+
+#endif // SPSC_MPSC_QUEUE_H
@@ -6,7 +6,7 @@ make clean && clear && make
 ./containers --help
 
 input_file="input_test_files/256in1-10000.txt"
-data_structures=("SGLQueue" "SGLStack" "TS" "msqueue")
+data_structures=("SGLQueue" "SGLStack" "TS" "msqueue" "faaqueue" "ringqueue" "twolockqueue" "spscqueue" "mpscqueue")
 thread_counts=(2 5 10 20 25 30 35 40 45 50 55 60 65 70 75 80 85 90 95 100)
 
 # Loop through data structures
@@ -20,16 +20,106 @@ for data_structure in "${data_structures[@]}"; do
         echo "Testing $data_structure with no optimization:"
         ./containers -i $input_file --data_structure=$data_structure --optimization=none -t $num_threads
 
-        # Apply Elimination only for stacks
-        if [ "$data_structure" == "SGLStack" ] || [ "$data_structure" == "TS" ]; then
+        # Apply Elimination only for stacks and the M&S queue
+        if [ "$data_structure" == "SGLStack" ] || [ "$data_structure" == "TS" ] || [ "$data_structure" == "msqueue" ]; then
             echo "Testing $data_structure with Elimination optimization:"
             ./containers -i $input_file --data_structure=$data_structure --optimization=Elimination -t $num_threads
         fi
 
-        # Apply Flat Combining only for SGLStack 
-        if [ "$data_structure" == "SGLStack" ]; then
+        # Apply Flat Combining only for the SGL containers
+        if [ "$data_structure" == "SGLStack" ] || [ "$data_structure" == "SGLQueue" ]; then
             echo "Testing $data_structure with Flat-combining optimization:"
             ./containers -i $input_file --data_structure=$data_structure --optimization=Flat-combining -t $num_threads
+            echo "Testing $data_structure with Parallel-FC optimization:"
+            ./containers -i $input_file --data_structure=$data_structure --optimization=Parallel-FC -t $num_threads
         fi
+        if [ "$data_structure" == "SGLQueue" ]; then
+            echo "Testing $data_structure with Two-sided-FC optimization:"
+            ./containers -i $input_file --data_structure=$data_structure --optimization=Two-sided-FC -t $num_threads
+        fi
+    done
+done
+
+# Containers that only exist as flat combining wrappers of a sequential std container
+for data_structure in "SGLDeque" "SGLPriorityQueue"; do
+    for num_threads in "${thread_counts[@]}"; do
+        echo "Testing $data_structure with Flat-combining optimization and $num_threads threads:"
+        ./containers -i $input_file --data_structure=$data_structure --optimization=Flat-combining -t $num_threads
+    done
+done
+
+# Memory reclamation: throughput and peak RSS without reclamation, with hazard pointers and with epochs
+reclaimed_structures=("TS" "msqueue")
+reclamations=("none" "hazard" "epoch")
+for data_structure in "${reclaimed_structures[@]}"; do
+    for reclamation in "${reclamations[@]}"; do
+        echo "=========================="
+        echo "Benchmarking $data_structure with $reclamation reclamation"
+        echo "=========================="
+        ./containers -i $input_file --data_structure=$data_structure --benchmark=reclamation --reclamation=$reclamation -t 4 --rounds=2000
+
+        # A reader stalled inside an operation pins the epoch but only one hazard pointer
+        if [ "$reclamation" != "none" ]; then
+            echo "Benchmarking $data_structure with $reclamation reclamation and a stalled reader:"
+            ./containers -i $input_file --data_structure=$data_structure --benchmark=reclamation --reclamation=$reclamation -t 4 --rounds=2000 --stall=10000
+        fi
+    done
+done
+
+# Immediate node recycling, safe for the Treiber stacks thanks to the tagged top pointer
+echo "Benchmarking TS with recycle reclamation:"
+./containers -i $input_file --data_structure=TS --benchmark=reclamation --reclamation=recycle -t 4 --rounds=2000
+echo "Benchmarking TS with Elimination and recycle reclamation:"
+./containers -i $input_file --data_structure=TS --optimization=Elimination --benchmark=reclamation --reclamation=recycle -t 4 --rounds=2000
+
+# Batched push/pop, one CAS per batch of 1 to 256 values
+for optimization in none Elimination; do
+    echo "Benchmarking TS batches with $optimization optimization:"
+    ./containers -i $input_file --data_structure=TS --optimization=$optimization --benchmark=batch -t 4 --rounds=2000
+done
+echo "Benchmarking msqueue bulk enqueue/dequeue:"
+./containers -i $input_file --data_structure=msqueue --benchmark=batch -t 4 --rounds=2000
+
+# Single-consumer queues against the MPMC queues, 1 producer / 1 consumer and N producers / 1 consumer
+for num_threads in 2 5 10; do
+    echo "Benchmarking single-consumer queues with $num_threads threads:"
+    ./containers -i $input_file --benchmark=single_consumer -t $num_threads --rounds=2000
+done
+
+# Elimination hit rate and the range each thread settles on, from few to many threads
+for data_structure in "TS" "SGLStack" "msqueue"; do
+    for num_threads in 2 4 16 50 100; do
+        echo "Benchmarking $data_structure elimination with $num_threads threads:"
+        ./containers -i $input_file --data_structure=$data_structure --benchmark=elimination -t $num_threads --rounds=200
+        ./containers -i $input_file --data_structure=$data_structure --benchmark=elimination -t $num_threads --rounds=200 --slot=cpu
+    done
+done
+
+# One combiner against several, at the thread counts where a single combiner plateaus
+for data_structure in "SGLStack" "SGLQueue"; do
+    for num_threads in 8 16 32 64 100; do
+        echo "Benchmarking $data_structure flat combining with $num_threads threads:"
+        ./containers -i $input_file --data_structure=$data_structure --benchmark=combining -t $num_threads --rounds=200
+    done
+done
+
+# Every lock inside the SGL containers, around the critical section and as the combiner election
+for optimization in none Elimination Flat-combining; do
+    for data_structure in "SGLStack" "SGLQueue"; do
+        if [ "$optimization" == "Elimination" ] && [ "$data_structure" == "SGLQueue" ]; then
+            continue
+        fi
+        for num_threads in 2 8 32 100; do
+            echo "Benchmarking $data_structure locks with $optimization optimization and $num_threads threads:"
+            ./containers -i $input_file --data_structure=$data_structure --optimization=$optimization --benchmark=lock -t $num_threads --rounds=100
+        done
+    done
+done
+
+# MPMC queues from one lock to none, with the locks that park and the ones that spin
+for lock in mutex ttas mcs; do
+    for num_threads in 2 8 32 100; do
+        echo "Benchmarking MPMC queues with $lock locks and $num_threads threads:"
+        ./containers -i $input_file --benchmark=queue --lock=$lock -t $num_threads --rounds=100
     done
 done
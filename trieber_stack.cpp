@@ -6,77 +6,29 @@
  * non-blocking data structure. It is linearizable and lock-free
  * 
  * Garbage Collection Issues currently dealt with 
- * 1) Race against reclaimation - Done 
- * 2) ABA problem - To-do
+ * 1) Race against reclaimation - Done (hazard pointers or epochs)
+ * 2) ABA problem - Done (top is a {pointer, counter} pair swapped with a 16-byte CAS)
  * 
  * @date 14 Dec 2023
 ********************************************************************/
 
 #include <cstddef>  // for std::uintptr_t
+#include <iterator>
+#include <memory>
+#include <string>
 #include "trieber_stack.h"
 
-#define CONTENTION_OPT 1
-
 using namespace std;
-/** Pushes the value onto the stack
- * 
- * @param val integer to be added onto the stack
- */
-void tstack::push(int val){
-    // Creating a new node and attempting to push it onto the stack
-    node* n = new node(val);
-    node* old_top;
-    do {
-        old_top = top.load(ACQUIRE); // Load the current value of top
-        n->down.store(old_top, RELAXED); // Set the new node's next pointer to the current top
-        // Attempt to swap the old top with the new top.
-        // If another thread has modified the top, the CAS will fail and retry.
-#if CONTENTION_OPT == 0
-    } while(!cas(top, old_top, n, ACQ_REL)); // This is the linearization point of push
-#else
-    } while(top.load(ACQUIRE) == old_top && !cas(top, old_top, n, ACQ_REL));
-#endif
-    DEBUG_MSG(val);
-}
-
-
-/** Returns the most recent pushed value - recent is defined by linearizability
- * 
- * @return The value of the popped node, or NULL if the stack is empty.
- */
-int tstack::pop(void){
-    node* t;
-    node* n;
-    int v;
-    do {
-        t = top.load(ACQUIRE); // Load the current value of top
-
-        if(t == nullptr){ 
-            return -1; // Stack is empty, return NULL
-        }
-        n = t->down.load(RELAXED); // Get the next node
-        v = t->val.load(RELAXED); // Read the value from the current top node
-        // Attempt to swap the old top with the new top.
-        // If another thread has modified the top, the CAS will fail and retry.
-#if CONTENTION_OPT == 0
-    } while(!cas(top, t, n, ACQ_REL)); // This is the linearization point of pop
-#else 
-    } while(top.load(ACQUIRE) == t && !cas(top, t, n, ACQ_REL));
-#endif
-    // Memory reclamation should be performed here.
-    //delete t;
-    // Delete the old node after ensuring no other threads are accessing it.
-    DEBUG_MSG(v);
-    return v; // Return the value of the popped node
-}
 
-void Push(tstack& stack, int val) {
+void Push(tstack<int>& stack, int val) {
     stack.push(val);
+    DEBUG_MSG(val);
 }
 
-void Pop(tstack& stack, std::atomic<int>& popCount) {
-    int val = stack.pop();
-    if ( val != -1) {
+void Pop(tstack<int>& stack, std::atomic<int>& popCount) {
+    int val;
+    if (stack.try_pop(val)) {
+        DEBUG_MSG(val);
         popCount.fetch_add(1, RELAXED);
     }else{DEBUG_MSG("Stack is empty");}
 }
@@ -84,14 +36,18 @@ void Pop(tstack& stack, std::atomic<int>& popCount) {
 /** Test for Treiber Stack where a vector of values are being pushed into the stack
  * by multiple threads (numThreads) and being popped out of the stack concurrently
  * with a chosen optimization. The test passes if the number of pushes are equal to the
- * number of pops.
+ * number of pops. The single-threaded checks of testGenericValues and
+ * testBatchOperations run first.
  * 
  * @param values The values to push onto the stack.
  * @param optimization The optimization strategy used (not used in this function).
  * @param numThreads The number of threads used for pushing and popping.
  */ 
 void treiber_stack_test(std::vector<int>& values, int numThreads) {
-    tstack stack;
+    testGenericValues();
+    testBatchOperations();
+
+    tstack<int> stack;
     std::atomic<int> popCount(0);
     std::vector<std::thread> threads;
 
@@ -144,20 +100,20 @@ void treiber_stack_test(std::vector<int>& values, int numThreads) {
 
 void push_pop(void){
     /************ Testing for the Trieber Stack here **********/
-    tstack stack; // Create an instance of tstack
+    tstack<int> stack; // Create an instance of tstack
 
     // Test the push function
     std::cout << "Pushing then popping alternatively" << std::endl;
     stack.push(1);
-    cout << "Value is " << stack.pop() << endl;
+    cout << "Value is " << *stack.pop() << endl;
     stack.push(2);
-    cout << "Value is " << stack.pop() << endl;
+    cout << "Value is " << *stack.pop() << endl;
     stack.push(3);
-    cout << "Value is " << stack.pop() << endl;
+    cout << "Value is " << *stack.pop() << endl;
 }
 void push3_pop_till_empty(void){
     /************ Testing for the Trieber Stack here **********/
-    tstack stack; // Create an instance of tstack
+    tstack<int> stack; // Create an instance of tstack
 
     // Test the push function
     std::cout << "Pushing values onto the stack..." << std::endl;
@@ -168,7 +124,70 @@ void push3_pop_till_empty(void){
     // Test the pop function
     std::cout << "Popping values from the stack till empty..." << std::endl;
     int val;
-    while ((val = stack.pop()) != -1) { // Continue popping until the stack is empty
+    while (stack.try_pop(val)) { // Continue popping until the stack is empty
         std::cout << "Popped: " << val << std::endl;
     }
 }
+
+/** Checks that the stack is not tied to int: -1 is an ordinary value,
+ *  strings are moved in and out, and move-only values are accepted.
+ */
+void testGenericValues(void){
+    tstack<int> ints;
+    ints.push(-1);
+    std::optional<int> v = ints.pop();
+    assert(v && *v == -1);
+    assert(!ints.pop());
+
+    tstack<std::string> strings;
+    strings.push("first");
+    strings.push(std::string(100, 'x')); // Heap allocated, must be moved not copied
+    std::string s;
+    assert(strings.try_pop(s) && s.size() == 100);
+    assert(*strings.pop() == "first");
+    assert(!strings.try_pop(s));
+
+    tstack<std::unique_ptr<int>> owned;
+    owned.push(std::make_unique<int>(7));
+    owned.push(std::make_unique<int>(8)); // Left on the stack for the destructor
+    std::optional<std::unique_ptr<int>> p = owned.pop();
+    assert(p && **p == 8);
+    std::cout << "Test for generic Treiber stack values passed" << std::endl;
+}
+
+/** Checks push_batch/pop_n/pop_all against the order single pushes and
+ *  pops would give.
+ */
+void testBatchOperations(void){
+    tstack<int> stack;
+    std::vector<int> in = {1, 2, 3, 4, 5};
+    stack.push(0);
+    stack.push_batch(in.begin(), in.end()); // Same as pushing 1..5 in order
+
+    std::vector<int> out;
+    assert(stack.pop_n(std::back_inserter(out), 2) == 2);
+    assert((out == std::vector<int>{5, 4}));
+    assert(*stack.pop() == 3);
+
+    out.clear();
+    assert(stack.pop_all(std::back_inserter(out)) == 3);
+    assert((out == std::vector<int>{2, 1, 0}));
+    assert(stack.pop_n(std::back_inserter(out), 4) == 0);
+    assert(stack.pop_all(std::back_inserter(out)) == 0);
+
+    // pop_n stops at the bottom of the stack
+    stack.push_batch(in.begin(), in.begin() + 2);
+    out.clear();
+    assert(stack.pop_n(std::back_inserter(out), 10) == 2);
+    assert((out == std::vector<int>{2, 1}));
+
+    // Move-only values go through move iterators
+    tstack<std::unique_ptr<int>> owned;
+    std::vector<std::unique_ptr<int>> ptrs;
+    ptrs.push_back(std::make_unique<int>(1));
+    ptrs.push_back(std::make_unique<int>(2));
+    owned.push_batch(std::make_move_iterator(ptrs.begin()), std::make_move_iterator(ptrs.end()));
+    std::vector<std::unique_ptr<int>> popped;
+    assert(owned.pop_all(std::back_inserter(popped)) == 2 && *popped[0] == 2);
+    std::cout << "Test for Treiber stack batch operations passed" << std::endl;
+}
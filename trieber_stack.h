@@ -6,8 +6,8 @@
  * non-blocking data structure. It is linearizable and lock-free
  * 
  * Garbage Collection Issues currently dealt with 
- * 1) Race against reclaimation - Done 
- * 2) ABA problem - To-do
+ * 1) Race against reclaimation - Done (hazard pointers or epochs)
+ * 2) ABA problem - Done (top is a {pointer, counter} pair swapped with a 16-byte CAS)
  * 
  * @date 14 Dec 2023
 ********************************************************************/
@@ -15,28 +15,296 @@
 #define TRIEBER_STACK_H
 
 #include "my_atomics.h"
+#include "reclamation.h"
+#include "node_pool.h"
 #include <cstddef>  // for std::uintptr_t
+#include <optional>
 #include <assert.h>
 
 /** Nonblocking data structure which is linearizable and Lock-free
  * 
+ * @tparam T         Type of the values, only needs to be movable
+ * @tparam Reclaimer Memory reclamation scheme used for popped nodes
+ *                   (see reclamation.h)
  */
+template <typename T, typename Reclaimer = DefaultReclaimer>
 class tstack{
 public:
-    struct node{
-        atomic<int> val;    // Data variable of the node
+    struct node : PoolAllocated<node>{ // Allocated from the per-thread node pool
+        NodeValue<T> val;   // Data variable of the node, stored inline
         atomic<node*> down; // This is like a next pointer of a node in LIFO
-        node(int v) : val(v), down(nullptr) {} // Constructor of node
+        template <typename U>
+        node(U&& v) : down(nullptr) { val.emplace(std::forward<U>(v)); } // Constructor of node
     };
-    atomic<node*> top; // Now an atomic cnt_ptr, not just a pointer to node
+    atomic_tagged<node> top; // Now an atomic cnt_ptr, not just a pointer to node
+    EventCount nonempty;     // Consumers parked in pop_wait/try_pop_for
 
-    void push(int val); 
-    int pop();
+    ~tstack();
+    void push(T val); 
+    bool try_pop(T& out);
+    std::optional<T> pop();
+    T pop_wait();
+    template <typename Rep, typename Period>
+    std::optional<T> try_pop_for(const std::chrono::duration<Rep, Period>& timeout);
+
+    template <typename It>
+    void push_batch(It first, It last);
+    template <typename OutIt>
+    size_t pop_all(OutIt out);
+    template <typename OutIt>
+    size_t pop_n(OutIt out, size_t n);
+
+private:
+    node* detach(size_t n);
+    template <typename OutIt>
+    size_t drain(node* chain, OutIt out);
 };
 
+#define CONTENTION_OPT 1
+
+/** Frees the nodes still on the stack. Must not run concurrently with
+ *  any other operation.
+ */
+template <typename T, typename Reclaimer>
+tstack<T, Reclaimer>::~tstack(){
+    node* t = top.load(RELAXED).ptr;
+    while (t != nullptr) {
+        node* n = t->down.load(RELAXED);
+        t->val.destroy();
+        delete t;
+        t = n;
+    }
+}
+
+/** Pushes the value onto the stack
+ * 
+ * @param val value to be added onto the stack, moved into the node
+ */
+template <typename T, typename Reclaimer>
+void tstack<T, Reclaimer>::push(T val){
+    // Creating a new node and attempting to push it onto the stack
+    node* n = new node(std::move(val));
+    tagged_ptr<node> old_top;
+    do {
+        old_top = top.load(ACQUIRE); // Load the current value of top
+        n->down.store(old_top.ptr, RELAXED); // Set the new node's next pointer to the current top
+        // Attempt to swap the old top with the new top.
+        // If another thread has modified the top (or its tag), the CAS will fail and retry.
+#if CONTENTION_OPT == 0
+    } while(!cas(top, old_top, n)); // This is the linearization point of push
+#else
+    } while(top.load(ACQUIRE) != old_top || !cas(top, old_top, n));
+#endif
+    nonempty.notify(); // One load unless a consumer is parked
+}
+
+
+/** Removes the most recent pushed value - recent is defined by linearizability
+ * 
+ * @return The popped value, or nothing if the stack is empty
+ */
+template <typename T, typename Reclaimer>
+std::optional<T> tstack<T, Reclaimer>::pop(){
+    typename Reclaimer::Guard guard;
+    tagged_ptr<node> t;
+    node* n;
+    while (true) {
+        t = top.load(ACQUIRE); // Load the current value of top
+
+        if(t.ptr == nullptr){ 
+            return std::nullopt; // Stack is empty
+        }
+        // Keep t from being freed under us, it must still be on top once published
+        guard.set(0, t.ptr);
+        if (top.load(SEQ_CST) != t) {
+            continue;
+        }
+        n = t.ptr->down.load(RELAXED); // Get the next node
+        // Attempt to swap the old top with the new top.
+        // If another thread has modified the top, the CAS will fail and retry.
+        // A stale t that was popped and pushed again has a new tag and fails too.
+#if CONTENTION_OPT == 0
+        if (cas(top, t, n)) break; // This is the linearization point of pop
+#else 
+        if (top.load(ACQUIRE) == t && cas(top, t, n)) break;
+#endif
+    }
+    // Only the thread whose CAS unlinked t reads its value
+    std::optional<T> out(t.ptr->val.take());
+    if constexpr (Reclaimer::recycles) {
+        delete t.ptr; // Straight back to the node pool, the tag makes immediate reuse safe
+    } else {
+        // t is unlinked, free it once no other thread holds a hazard on it
+        guard.clear(0);
+        Reclaimer::retire(t.ptr);
+    }
+    return out;
+}
+
+/** Pops, waiting while the stack is empty. Spins briefly, then sleeps
+ *  until a push wakes it up.
+ */
+template <typename T, typename Reclaimer>
+T tstack<T, Reclaimer>::pop_wait(){
+    return std::move(*wait_pop(nonempty, [this]() { return pop(); }));
+}
+
+/** Pops, waiting at most timeout while the stack is empty
+ *
+ * @return The popped value, or nothing if the stack stayed empty
+ */
+template <typename T, typename Reclaimer>
+template <typename Rep, typename Period>
+std::optional<T> tstack<T, Reclaimer>::try_pop_for(const std::chrono::duration<Rep, Period>& timeout){
+    return wait_pop_until(nonempty, [this]() { return pop(); }, std::chrono::steady_clock::now() + timeout);
+}
+
+/** Pops into out, for callers that already own storage for the value
+ * 
+ * @param out Receives the popped value, untouched if the stack is empty
+ * @return false if the stack is empty
+ */
+template <typename T, typename Reclaimer>
+bool tstack<T, Reclaimer>::try_pop(T& out){
+    std::optional<T> v = pop();
+    if (!v) {
+        return false;
+    }
+    out = std::move(*v);
+    return true;
+}
+
+/** Pushes [first, last) with a single CAS on top. The nodes are linked
+ *  privately first, so the batch appears all at once, as if the values had
+ *  been pushed one after the other: *(last - 1) ends up on top.
+ *
+ *  The values are constructed from *it, pass move iterators to move them.
+ */
+template <typename T, typename Reclaimer>
+template <typename It>
+void tstack<T, Reclaimer>::push_batch(It first, It last){
+    if (first == last) {
+        return;
+    }
+    // Build the chain bottom up, chain_top is the last value
+    node* chain_bottom = new node(*first);
+    node* chain_top = chain_bottom;
+    for (++first; first != last; ++first) {
+        node* n = new node(*first);
+        n->down.store(chain_top, RELAXED);
+        chain_top = n;
+    }
+    tagged_ptr<node> old_top;
+    do {
+        old_top = top.load(ACQUIRE);
+        chain_bottom->down.store(old_top.ptr, RELAXED); // Splice the chain over the current top
+#if CONTENTION_OPT == 0
+    } while(!cas(top, old_top, chain_top));
+#else
+    } while(top.load(ACQUIRE) != old_top || !cas(top, old_top, chain_top));
+#endif
+    nonempty.notify();
+}
+
+/** Unlinks up to n nodes from the top with a single CAS.
+ *
+ *  The walk down the stack is validated against top after every step:
+ *  every successful operation bumps the tag, so an unchanged top means no
+ *  node on the walked prefix was popped (let alone freed) before its down
+ *  pointer was read. That needs no hazard slot per node. A read that raced
+ *  with a pop is thrown away before it is followed, and stays within
+ *  NodePool memory, which is never unmapped.
+ *
+ * @return The detached chain, linked through down and ended by nullptr,
+ *         or nullptr if the stack is empty
+ */
+template <typename T, typename Reclaimer>
+typename tstack<T, Reclaimer>::node* tstack<T, Reclaimer>::detach(size_t n){
+    while (true) {
+        tagged_ptr<node> t = top.load(ACQUIRE);
+        if (t.ptr == nullptr || n == 0) {
+            return nullptr;
+        }
+        node* last = t.ptr;
+        node* rest = nullptr;
+        bool valid = true;
+        for (size_t i = 0; ; ++i) {
+            rest = last->down.load(RELAXED);
+            if (top.load(SEQ_CST) != t) {
+                valid = false; // The stack changed under the walk, last may be gone
+                break;
+            }
+            if (i + 1 == n || rest == nullptr) {
+                break;
+            }
+            last = rest;
+        }
+        if (!valid) {
+            continue;
+        }
+        if (cas(top, t, rest)) {
+            // The chain is ours now, cut it off from what stays on the stack
+            last->down.store(nullptr, RELAXED);
+            return t.ptr;
+        }
+    }
+}
+
+/** Moves the values of a detached chain to out (top first) and hands the
+ *  nodes to the reclaimer. Other threads may still hold a stale pointer to
+ *  any of them, so they are retired like popped nodes.
+ */
+template <typename T, typename Reclaimer>
+template <typename OutIt>
+size_t tstack<T, Reclaimer>::drain(node* chain, OutIt out){
+    size_t count = 0;
+    while (chain != nullptr) {
+        node* next = chain->down.load(RELAXED);
+        *out++ = chain->val.take();
+        if constexpr (Reclaimer::recycles) {
+            delete chain;
+        } else {
+            Reclaimer::retire(chain);
+        }
+        chain = next;
+        ++count;
+    }
+    return count;
+}
+
+/** Empties the stack with a single CAS
+ *
+ * @param out Receives the values in pop order (most recent first)
+ * @return The number of values popped
+ */
+template <typename T, typename Reclaimer>
+template <typename OutIt>
+size_t tstack<T, Reclaimer>::pop_all(OutIt out){
+    tagged_ptr<node> t;
+    do {
+        t = top.load(ACQUIRE);
+        if (t.ptr == nullptr) {
+            return 0;
+        }
+    } while (!cas(top, t, (node*)nullptr)); // No node is read before the CAS, nothing to protect
+    return drain(t.ptr, out);
+}
+
+/** Pops up to n values with a single CAS
+ *
+ * @param out Receives the values in pop order (most recent first)
+ * @return The number of values popped, less than n if the stack ran out
+ */
+template <typename T, typename Reclaimer>
+template <typename OutIt>
+size_t tstack<T, Reclaimer>::pop_n(OutIt out, size_t n){
+    return drain(detach(n), out);
+}
 
 void push3_pop_till_empty(void);
 void push_pop(void);
 void testConcurrentPushPop();
+void testGenericValues();
+void testBatchOperations();
 void treiber_stack_test(std::vector<int>& values, int numThreads);
 #endif
\ No newline at end of file
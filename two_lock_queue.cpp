@@ -0,0 +1,100 @@
+/*****************************************************************
+ * @author Suraj Ajjampur
+ * @file   two_lock_queue.cpp
+ *
+ * @brief This C++ source file tests the Michael & Scott two-lock queue.
+ *
+ * @date 16 Oct 2026
+********************************************************************/
+
+#include "two_lock_queue.h"
+#include <memory>
+#include <numeric>
+#include <vector>
+
+void testBasicTwoLockQueueOperations() {
+    twolockqueue<int> queue;
+    assert(!queue.dequeue()); // Only the dummy
+
+    queue.enqueue(1);
+    queue.enqueue(2);
+    assert(*queue.dequeue() == 1);
+    queue.enqueue(3);
+    int val;
+    assert(queue.try_dequeue(val) && val == 2);
+    assert(*queue.dequeue() == 3);
+    assert(!queue.try_dequeue(val));
+
+    twolockqueue<std::unique_ptr<int>, TicketLock> owned;
+    owned.enqueue(std::make_unique<int>(1));
+    owned.enqueue(std::make_unique<int>(2)); // Left for the destructor
+    assert(**owned.dequeue() == 1);
+
+    std::cout << "Test Basic Two-Lock Queue Operations: Passed" << std::endl;
+}
+
+/**
+ * @brief Tests the two-lock queue with a given set of values and a specified number of threads.
+ *
+ * Half of the threads enqueue their share of the values, the other half
+ * dequeue until every value has been taken out. The test passes if the sum
+ * of dequeued values matches the sum of the input. The single-threaded
+ * checks of testBasicTwoLockQueueOperations run first.
+ *
+ * @param values A vector of integers to be enqueued into the queue.
+ * @param numThreads The total number of threads to be used for concurrent enqueue and dequeue operations.
+ * @param lock The lock of both ends.
+ */
+void two_lock_queue_test(std::vector<int>& values, int numThreads, LockKind lock) {
+    testBasicTwoLockQueueOperations();
+
+    with_lock(lock, [&]<typename Lock>() {
+        twolockqueue<int, Lock> queue;
+        std::atomic<int> sum(0);
+        std::atomic<size_t> dequeued(0);
+        std::vector<std::thread> threads;
+
+        int halfNumThreads = numThreads / 2;
+        if (halfNumThreads == 0) halfNumThreads = 1;
+
+        // Concurrent enqueues
+        for (int i = 0; i < halfNumThreads; ++i) {
+            threads.push_back(std::thread([&queue, &values, i, halfNumThreads]() {
+                for (size_t j = i; j < values.size(); j += halfNumThreads) {
+                    queue.enqueue(values[j]);
+                }
+            }));
+        }
+
+        // Concurrent dequeues, until all values are out
+        for (int i = 0; i < halfNumThreads; ++i) {
+            threads.push_back(std::thread([&queue, &sum, &dequeued, &values]() {
+                int val;
+                while (dequeued.load(RELAXED) < values.size()) {
+                    if (queue.try_dequeue(val)) {
+                        sum.fetch_add(val, RELAXED);
+                        dequeued.fetch_add(1, RELAXED);
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            }));
+        }
+
+        // Wait for all threads to complete
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        // Calculate the expected sum of the vector
+        int expectedSum = std::accumulate(values.begin(), values.end(), 0);
+
+        // Check if the sum of dequeued values is correct
+        if (sum != expectedSum) {
+            std::cerr << "Error: The sum of dequeued values does not match the expected sum." << std::endl;
+            std::cerr << "Sum: " << sum << ", Expected: " << expectedSum << std::endl;
+        } else {
+            std::cout << "Test for two-lock queue passed (" << lock_name(lock) << " locks) !" << std::endl;
+        }
+    });
+}
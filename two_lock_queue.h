@@ -0,0 +1,130 @@
+/*****************************************************************
+ * @author Suraj Ajjampur
+ * @file   two_lock_queue.h
+ *
+ * @brief This C++ header file implements the Michael & Scott two-lock
+ *        queue: a linked list with a dummy node, one lock for the head
+ *        and one for the tail.
+ *
+ * Enqueuers only take the tail lock and dequeuers only the head lock, so a
+ * producer and a consumer never wait for each other, unlike in SGLQueue.
+ * The dummy node keeps the two ends apart: even when the queue is empty
+ * head and tail point to the same dummy, and the only field both sides
+ * touch is its next pointer, written by the enqueuer with a release store
+ * and read by the dequeuer with an acquire load.
+ *
+ * Unlike msqueue, threads that lose the race for an end wait on its lock
+ * instead of retrying a CAS, and with std::mutex they sleep in the kernel
+ * rather than spin, which is what an oversubscribed machine wants. A
+ * dequeued dummy is freed right away: no enqueuer can still be using it,
+ * so no reclamation scheme is needed.
+ *
+ * @date 16 Oct 2026
+********************************************************************/
+
+#ifndef TWO_LOCK_QUEUE_H
+#define TWO_LOCK_QUEUE_H
+
+#include "my_atomics.h"
+#include "node_pool.h"
+#include <mutex>
+#include <optional>
+#include <assert.h>
+
+/** Michael & Scott two-lock queue
+ *
+ * @tparam T    Type of the values, only needs to be movable
+ * @tparam Lock Lock of each end, std::mutex or a policy of my_atomics.h
+ */
+template <typename T, typename Lock = std::mutex>
+class twolockqueue {
+public:
+    struct node : PoolAllocated<node> { // Allocated from the per-thread node pool
+        NodeValue<T> val;
+        std::atomic<node*> next;
+        node() : next(nullptr) {} // Dummy, carries no value
+        template <typename U>
+        node(U&& v) : next(nullptr) { val.emplace(std::forward<U>(v)); }
+    };
+
+    twolockqueue();
+    ~twolockqueue();
+    void enqueue(T val);
+    bool try_dequeue(T& out);
+    std::optional<T> dequeue();
+
+private:
+    // Each end with its lock on its own cache line
+    alignas(CACHE_LINE_SIZE) Lock head_lock;
+    node* head; // Dummy, under head_lock
+    alignas(CACHE_LINE_SIZE) Lock tail_lock;
+    node* tail; // Last node, under tail_lock
+};
+
+template <typename T, typename Lock>
+twolockqueue<T, Lock>::twolockqueue() {
+    node* dummy = new node();
+    head = dummy;
+    tail = dummy;
+}
+
+/** Frees the dummy and every node still in the queue. Must not run
+ *  concurrently with any other operation.
+ */
+template <typename T, typename Lock>
+twolockqueue<T, Lock>::~twolockqueue() {
+    node* h = head;
+    bool dummy = true;
+    while (h != nullptr) {
+        node* n = h->next.load(RELAXED);
+        if (!dummy) h->val.destroy();
+        dummy = false;
+        delete h;
+        h = n;
+    }
+}
+
+/** @param val Value to be enqueued, moved into the node */
+template <typename T, typename Lock>
+void twolockqueue<T, Lock>::enqueue(T val) {
+    node* n = new node(std::move(val)); // Outside the lock
+    std::lock_guard<Lock> lock(tail_lock);
+    tail->next.store(n, RELEASE); // Linearization point, publishes the value to dequeuers
+    tail = n;
+}
+
+/** @return The oldest value, or nothing if the queue is empty */
+template <typename T, typename Lock>
+std::optional<T> twolockqueue<T, Lock>::dequeue() {
+    node* h;
+    std::optional<T> ret;
+    {
+        std::lock_guard<Lock> lock(head_lock);
+        h = head;
+        node* n = h->next.load(ACQUIRE);
+        if (n == nullptr) {
+            return std::nullopt;
+        }
+        ret.emplace(n->val.take());
+        head = n; // n becomes the dummy
+    }
+    // The enqueuer that linked n is done with h, and tail has moved past it
+    delete h;
+    return ret;
+}
+
+/** @return false if the queue is empty, out is then left untouched */
+template <typename T, typename Lock>
+bool twolockqueue<T, Lock>::try_dequeue(T& out) {
+    std::optional<T> v = dequeue();
+    if (!v) {
+        return false;
+    }
+    out = std::move(*v);
+    return true;
+}
+
+void testBasicTwoLockQueueOperations();
+void two_lock_queue_test(std::vector<int>& values, int numThreads, LockKind lock = MUTEX_LOCK);
+
+#endif // TWO_LOCK_QUEUE_H